@@ -6,6 +6,7 @@ import { logger } from "../utils/logger.js";
 import type { DeviceManager } from "./deviceManager.js";
 import type { DirectRouter } from "./directRouter.js";
 import axios from "axios";
+import { createSocket, type RemoteInfo, type Socket as UdpSocket } from "node:dgram";
 
 interface ArduinoSession {
   id: string;
@@ -15,8 +16,32 @@ interface ArduinoSession {
   status: "connected" | "disconnected" | "error";
 }
 
+// Telemetría UDP (ver arduino-refactored/udp_telemetry.h):
+// 'S','T', flags, seq (uint16 LE) y el mismo JSON que POST /dispatch.
+// Con TELEMETRY_FLAG_ACK se responde 'S','A', 0, seq
+const TELEMETRY_HEADER_BYTES = 5;
+const TELEMETRY_FLAG_ACK = 0x01;
+
+// Campos del evento: cada consumidor comprueba los que usa
+type ArduinoEventData = Record<string, unknown>;
+
+interface ArduinoEventBody {
+  arduinoId?: string;
+  event?: string;
+  data?: ArduinoEventData;
+}
+
+// seq posterior a 'last' con vuelta a 0 en 16 bits: dentro de la media
+// ventana siguiente. Igual o anterior es un reenvío o un datagrama adelantado
+function seqIsNewer(seq: number, last: number): boolean {
+  const diff = (seq - last) & 0xffff;
+  return diff !== 0 && diff < 0x8000;
+}
+
 export class ArduinoBridge {
   private readonly sessions = new Map<string, ArduinoSession>();
+  // Último seq UDP aplicado por Arduino
+  private readonly lastSeq = new Map<string, number>();
 
   constructor(
     private readonly app: Express,
@@ -50,6 +75,7 @@ export class ArduinoBridge {
       };
 
       this.sessions.set(id, session);
+      this.lastSeq.delete(id); // tras reiniciar, el seq UDP vuelve a empezar
       logger.info(`[ArduinoBridge] Arduino connected: ${id} (${ip}:${port})`);
 
       // Registrar en DeviceManager simulando un dispositivo HTTP
@@ -90,41 +116,13 @@ export class ArduinoBridge {
 
     // POST /dispatch - Arduino envía eventos
     this.app.post("/dispatch", (req: Request, res: Response) => {
-      const { arduinoId, event, data } = req.body;
+      const { arduinoId, event, data } = req.body as ArduinoEventBody;
 
       if (!arduinoId || !event) {
         return res.status(400).json({ error: "Missing arduinoId or event" });
       }
 
-      logger.info(`[ArduinoBridge] Event from Arduino ${arduinoId}: ${event}`, data);
-
-      // Distribuir evento a todas las apps React conectadas vía Socket.io
-      this.io.emit(event, data);
-
-      this.bus.emit(SERVER_EVENTS.HARDWARE_EVENT, {
-        device: arduinoId as DeviceId,
-        instanceId: arduinoId,
-        at: Date.now(),
-        event,
-        payload: data,
-        ip: this.sessions.get(arduinoId)?.ip
-      });
-
-      // Si el Arduino es buttons-arduino y envía estado de botones,
-      // reenviar al buttons-game usando el comando set-state
-      if (arduinoId === DEVICE.BUTTONS_ARDUINO && data && Array.isArray(data.buttons)) {
-        this.forwardButtonStateToGame(data);
-      }
-
-      // Si el Arduino de connections completa, iniciar totem fase 1
-      if (arduinoId === "connections" && data && data.completed === true) {
-        this.triggerTotemStart(1, "connections-completed");
-      }
-
-      // Si el Arduino de rfid completa, iniciar totem fase 2
-      if (arduinoId === "rfid" && data && data.completed === true) {
-        this.triggerTotemStart(2, "rfid-completed");
-      }
+      this.handleDispatch(arduinoId, event, data);
 
       res.json({
         status: "received",
@@ -137,6 +135,100 @@ export class ArduinoBridge {
         status: "heartbeat received",
       });
     });
+
+    this.startTelemetry();
+  }
+
+  // Evento de un Arduino, llegue por POST /dispatch o por UDP
+  private handleDispatch(arduinoId: string, event: string, data: ArduinoEventData | undefined): void {
+    logger.info(`[ArduinoBridge] Event from Arduino ${arduinoId}: ${event}`, data);
+
+    // Distribuir evento a todas las apps React conectadas vía Socket.io
+    this.io.emit(event, data);
+
+    this.bus.emit(SERVER_EVENTS.HARDWARE_EVENT, {
+      device: arduinoId as DeviceId,
+      instanceId: arduinoId,
+      at: Date.now(),
+      event,
+      payload: data,
+      ip: this.sessions.get(arduinoId)?.ip
+    });
+
+    // Si el Arduino es buttons-arduino y envía estado de botones,
+    // reenviar al buttons-game usando el comando set-state
+    const buttons = data?.buttons;
+    const completed = data?.completed;
+    if (arduinoId === DEVICE.BUTTONS_ARDUINO && Array.isArray(buttons)) {
+      this.forwardButtonStateToGame({
+        buttons,
+        completed: typeof completed === "boolean" ? completed : undefined
+      });
+    }
+
+    // Si el Arduino de connections completa, iniciar totem fase 1
+    if (arduinoId === "connections" && completed === true) {
+      this.triggerTotemStart(1, "connections-completed");
+    }
+
+    // Si el Arduino de rfid completa, iniciar totem fase 2
+    if (arduinoId === "rfid" && completed === true) {
+      this.triggerTotemStart(2, "rfid-completed");
+    }
+  }
+
+  // UDP/ARDUINO_UDP_PORT (3002 por defecto, 0 lo desactiva)
+  private startTelemetry(): void {
+    const port = parseInt(process.env.ARDUINO_UDP_PORT || "3002", 10);
+    if (!port) return;
+
+    const socket = createSocket("udp4");
+    socket.on("message", (msg: Buffer, rinfo: RemoteInfo) => {
+      this.handleTelemetry(socket, msg, rinfo);
+    });
+    socket.on("error", (error: Error) => {
+      logger.error(`[ArduinoBridge] UDP telemetry error: ${error.message}`);
+    });
+    socket.bind(port, () => {
+      logger.info(`[ArduinoBridge] UDP telemetry listening on port ${port}`);
+    });
+  }
+
+  private handleTelemetry(socket: UdpSocket, msg: Buffer, rinfo: RemoteInfo): void {
+    if (msg.length <= TELEMETRY_HEADER_BYTES || msg[0] !== 0x53 || msg[1] !== 0x54) {
+      return;
+    }
+    const flags = msg[2];
+    const seq = msg.readUInt16LE(3);
+
+    let body: ArduinoEventBody;
+    try {
+      body = JSON.parse(msg.subarray(TELEMETRY_HEADER_BYTES).toString("utf8"));
+    } catch {
+      logger.warn(`[ArduinoBridge] Invalid UDP telemetry from ${rinfo.address}:${rinfo.port}`);
+      return;
+    }
+
+    const { arduinoId, event, data } = body;
+    if (!arduinoId || !event) {
+      return;
+    }
+
+    if (flags & TELEMETRY_FLAG_ACK) {
+      socket.send(Buffer.from([0x53, 0x41, 0, seq & 0xff, seq >> 8]), rinfo.port, rinfo.address);
+    }
+
+    // Reenvío cuyo ACK se perdió, o estado más viejo que uno ya aplicado
+    // (UDP no garantiza el orden). Un crítico no se adelanta: en el Arduino
+    // nada sale detrás de él hasta que se confirma, así que su seq nunca
+    // queda por detrás de uno aplicado
+    const last = this.lastSeq.get(arduinoId);
+    if (last !== undefined && !seqIsNewer(seq, last)) {
+      return;
+    }
+    this.lastSeq.set(arduinoId, seq);
+
+    this.handleDispatch(arduinoId, event, data);
   }
 
   async sendCommandToArduino(arduinoId: string, command: "start" | "restart"): Promise<void> {
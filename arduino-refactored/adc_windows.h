@@ -0,0 +1,44 @@
+// ============================================================
+// VENTANAS ADC DE LOS CABLES (connections.cpp)
+//  - Cada cable se reconoce por su resistencia contra RREF en un divisor:
+//    R = RREF·adc/(1023-adc). Como R crece con adc, cada ventana
+//    [R_MIN,R_MAX] en ohmios es un rango de códigos [adcLo,adcHi]
+//  - El compilador saca los códigos con la misma cuenta en float que
+//    hacía antes adcToOhms(); en ejecución solo quedan dos comparaciones
+//    enteras por canal (AVR no tiene FPU)
+//  - Sin dependencias del hardware: test/adc_windows_test.cpp comprueba
+//    en el PC que para los 1024 códigos las dos comparaciones coinciden
+// Uso:
+//   const uint16_t ADC_LO[ADC_WINDOWS] PROGMEM = { adcLo(0), ... };
+//   bool dentro = adc >= adcLo(ch) && adc <= adcHi(ch);
+// ============================================================
+
+#ifndef ADC_WINDOWS_H
+#define ADC_WINDOWS_H
+
+#include <stdint.h>
+
+const uint8_t ADC_WINDOWS = 5;
+
+// Ventanas en ohmios: solo se usan en compilación (y en la prueba en host)
+constexpr float RREF = 20000.0f;
+constexpr float R_MIN[ADC_WINDOWS] = { 3250, 4750, 6750, 9800, 15100 };
+constexpr float R_MAX[ADC_WINDOWS] = { 3390, 4880, 6850, 10200, 15300 };
+
+// Igual que el antiguo adcToOhms(), evaluable por el compilador
+constexpr float adcOhms(uint16_t adc) {
+  return adc == 0 ? 0.0f : adc >= 1023 ? 1e12f : RREF * (float)adc / (1023.0f - (float)adc);
+}
+
+// Menor código en [lo,hi) con adcOhms >= r (o > r si strict); hi si no hay
+constexpr uint16_t adcLowerBound(float r, bool strict, uint16_t lo, uint16_t hi) {
+  return lo >= hi ? lo
+       : (strict ? adcOhms(lo + (hi - lo) / 2) > r : adcOhms(lo + (hi - lo) / 2) >= r)
+         ? adcLowerBound(r, strict, lo, lo + (hi - lo) / 2)
+         : adcLowerBound(r, strict, lo + (hi - lo) / 2 + 1, hi);
+}
+
+constexpr uint16_t adcLo(uint8_t ch) { return adcLowerBound(R_MIN[ch], false, 0, 1024); }
+constexpr uint16_t adcHi(uint8_t ch) { return adcLowerBound(R_MAX[ch], true, 0, 1024) - 1; }
+
+#endif
@@ -21,6 +21,24 @@
   #define DBGF(...) do{}while(0)
 #endif
 
+// Bus del ENC28J60: 0 = SPI compartido, 1 = USART1 en modo SPI (ver eth_spi.h)
+#define ETH_SPI_USART1 0
+#include "eth_spi.h"
+
+#if ETH_SPI_USART1
+  #error "ETH_SPI_USART1: D18/D19 (TX1/RX1) son los botones 4 y 3 en este sketch"
+#endif
+
+// Al arrancar, medir ciclos de CPU digitalRead/Write vs fast_gpio.h (Serial)
+#define GPIO_BENCH 0
+
+#include "scheduler.h"
+#include "fast_gpio.h"
+#include "rules.h"
+#include "spsc_queue.h"
+#include "backend_client.h"
+#include "dispatch_queue.h"
+
 // ============================================================
 // SECCIÓN 1: CONFIGURACIÓN HARDWARE Y JUEGO
 // ============================================================
@@ -28,13 +46,16 @@
 #define NUM_BUTTONS 10
 enum Btn { BOTON1=0,BOTON2,BOTON3,BOTON4,BOTON5,BOTON6,BOTON7,BOTON8,BOTON9,BOTON10 };
 
-// Configuración de la combinación correcta
-const unsigned char CORRECT_BUTTONS[] = { BOTON1, BOTON3 };   // ejemplo: 1 y 3 encendidos
-const unsigned char NUM_CORRECT = sizeof(CORRECT_BUTTONS)/sizeof(CORRECT_BUTTONS[0]);
+// Combinación correcta por defecto (bit i = botón i); se puede cambiar
+// en caliente con POST /control {"command":"rule",...} (ver rules.h)
+const uint16_t CORRECT_MASK = (1u << BOTON1) | (1u << BOTON3);   // ejemplo: 1 y 3 encendidos
 
-// Pines físicos
-const unsigned char buttonPins[NUM_BUTTONS] = {21,20,19,18,17,16,15,14,2,3};
-const unsigned char ledPinsBtn[NUM_BUTTONS] = {24,26,28,30,32,34,36,38,40,42};
+// Pines físicos (bit i = botón i; puertos resueltos en compilación)
+typedef PinGroup<21,20,19,18,17,16,15,14,2,3>    ButtonPins;
+typedef PinGroup<24,26,28,30,32,34,36,38,40,42> ButtonLeds;
+static_assert(ButtonPins::size == NUM_BUTTONS && ButtonLeds::size == NUM_BUTTONS, "tablas de botones");
+const uint16_t BTN_MASK_ALL = (1u << NUM_BUTTONS) - 1;
+const uint8_t RULE_SLOTS = 4;
 
 // LEDs de estado
 #define LED_ROJO     5
@@ -53,33 +74,37 @@ bool readyActive = false;
 unsigned long readyStartMs = 0;
 const unsigned long READY_DELAY_MS = 10000;
 
-bool buttonState[NUM_BUTTONS] = {0};
-unsigned long debounceTime[NUM_BUTTONS] = {0};
-const unsigned long DEBOUNCE_MS = 50;
+uint16_t buttonState = 0;   // bit i = botón i encendido
+RuleSet<RULE_SLOTS> rules(NUM_BUTTONS);
 int lastPressedButton = -1;
+unsigned long lastPressedUs = 0;   // micros() capturado en la ISR
+
+// Planificador cooperativo (tareas registradas en setup())
+Scheduler<4> sched;
+int8_t taskDispatch = -1;
+bool dispatchCompleted = false;   // el próximo dispatch lleva completed=true
 
 // ============================================================
 // SECCIÓN 3: LÓGICA DEL JUEGO (Funciones puras)
 // ============================================================
 
 void gameInit() {
-  memset(buttonState, 0, sizeof(buttonState));
-  memset(debounceTime, 0, sizeof(debounceTime));
+  buttonState = 0;
+  rules.set({ CORRECT_MASK, BTN_MASK_ALL & ~CORRECT_MASK });
   lastPressedButton = -1;
   gameRunning = false;
   readyActive = false;
 }
 
 void gameStart() {
-  memset(buttonState, 0, sizeof(buttonState));
-  memset(debounceTime, 0, sizeof(debounceTime));
+  buttonState = 0;
   lastPressedButton = -1;
   
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
   gameRunning = true;
   readyActive = true;
   readyStartMs = millis();
-  digitalWrite(LED_READY, HIGH);
+  FastPin<LED_READY>::high();
   
   DBG(F("🎮 JUEGO iniciado - READY: cuenta 10s (no bloqueante)"));
 }
@@ -87,20 +112,18 @@ void gameStart() {
 void gameStop() {
   gameRunning = false;
   readyActive = false;
-  digitalWrite(LED_GAME, LOW);
-  digitalWrite(LED_READY, LOW);
+  FastPin<LED_GAME>::low();
+  FastPin<LED_READY>::low();
   DBG(F("⏹️ Juego detenido"));
 }
 
 void gameRestart() {
   gameStop();
-  memset(buttonState, 0, sizeof(buttonState));
-  memset(debounceTime, 0, sizeof(debounceTime));
+  buttonState = 0;
   lastPressedButton = -1;
   
   // Actualizar LEDs de botones
-  for (int i=0; i<NUM_BUTTONS; i++)
-    digitalWrite(ledPinsBtn[i], buttonState[i] ? HIGH : LOW);
+  ButtonLeds::write(0);
     
   DBG(F("🔄 Juego reiniciado"));
 }
@@ -114,63 +137,169 @@ bool readyCountdownFinished() {
   
   if (millis() - readyStartMs >= READY_DELAY_MS) {
     readyActive = false;
-    digitalWrite(LED_READY, LOW);
+    FastPin<LED_READY>::low();
     DBG(F("✅ READY finalizado - Botones activos"));
     return true;
   }
   return false;
 }
 
-bool isButtonInCorrect(unsigned char idx) {
-  for (unsigned char k=0; k<NUM_CORRECT; k++) 
-    if (idx == CORRECT_BUTTONS[k]) return true;
-  return false;
+bool isGameCompleted() {
+  // Correctos encendidos y ninguno prohibido (una comparación por regla)
+  return rules.match(buttonState) >= 0;
+}
+
+// ====== CAPTURA DE FLANCOS Y ANTIRREBOTE ======
+// El antirrebote corre en TIMER0_COMPB (~1kHz, mismo timer que millis()):
+// cada BTN_SAMPLE_TICKS vueltas se leen los 10 botones de una vez y pasan
+// por contadores verticales de 2 bits (bit i de btnCnt0/btnCnt1 = contador
+// del botón i). Un botón cambia de estado tras 4 muestras seguidas distintas
+// de su estado estable; una muestra igual reinicia su contador. Solo
+// entonces se encola un flanco (pulsación o suelta) con su micros() en una
+// SpscQueue (productor = ISRs, que en AVR no se anidan; consumidor =
+// scanButtons()). Así no se pierde ninguna pulsación aunque la red
+// bloquee, y un botón mantenido da un único flanco.
+//  - D21,D20,D19,D18,D2,D3 → INT0..INT5 (cualquier flanco)
+//  - D15,D14 (PJ0,PJ1)     → PCINT9/PCINT10 (PCINT1_vect)
+//    Estas interrupciones no deciden nada: apuntan la hora del primer
+//    flanco en bruto, que es la que lleva el evento
+//  - D17,D16 (PH0,PH1)     → sin interrupción en el Mega: su hora es la
+//                            del muestreo en que se vio el cambio
+
+// INTn de cada botón (-1 = PCINT o solo muestreo)
+const int8_t BTN_EXT_INT[NUM_BUTTONS] = { 0, 1, 2, 3, -1, -1, -1, -1, 4, 5 };
+
+const uint8_t BTN_SAMPLE_TICKS = 4;                      // 4 × 1.024ms entre muestras
+const unsigned long BTN_DEBOUNCE_US = 4UL * BTN_SAMPLE_TICKS * 1024;   // ~16ms estable
+
+struct BtnEvent {
+  uint8_t btn;
+  bool pressed;
+  unsigned long us;
+};
+
+SpscQueue<BtnEvent, 32> btnQueue;
+
+uint16_t btnPcintMask = 0;           // botones atendidos por PCINT1
+volatile uint16_t btnStable = 0;     // estado sin rebotes (1 = presionado)
+
+// Solo ISR
+uint16_t btnCnt0 = BTN_MASK_ALL;     // contadores verticales (11 = reposo)
+uint16_t btnCnt1 = BTN_MASK_ALL;
+uint16_t btnArmed = 0;               // botones con hora de primer flanco apuntada
+unsigned long btnEdgeUs[NUM_BUTTONS];
+uint8_t btnTick = 0;
+
+// Apunta 'now' como hora de flanco de los botones de 'fresh'
+void btnStamp(uint16_t fresh, unsigned long now) {
+  btnArmed |= fresh;
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++)
+    if (fresh & (1u << i)) btnEdgeUs[i] = now;
+}
+
+// INTn / PCINT1: primer flanco en bruto de los botones de 'which' que se
+// apartan del estado estable
+void btnEdge(uint16_t which) {
+  uint16_t raw = ~ButtonPins::read() & BTN_MASK_ALL;   // PULLUP → LOW = presionado
+  uint16_t fresh = (raw ^ btnStable) & which & ~btnArmed;
+  if (fresh) btnStamp(fresh, micros());
+}
+
+// Muestreo + antirrebote de los 10 bits a la vez
+void btnSample() {
+  uint16_t raw = ~ButtonPins::read() & BTN_MASK_ALL;
+  uint16_t delta = raw ^ btnStable;
+
+  // Cambios que ninguna interrupción apuntó (D16/D17)
+  uint16_t fresh = delta & ~btnArmed;
+  if (fresh) btnStamp(fresh, micros());
+
+  // Donde delta = 0 el contador vuelve a 11; donde delta = 1 cuenta
+  // 11 → 10 → 01 → 00 → 11, y al dar la vuelta el botón cambia
+  btnCnt0 = ~(btnCnt0 & delta);
+  btnCnt1 = btnCnt0 ^ (btnCnt1 & delta);
+  uint16_t flip = delta & btnCnt0 & btnCnt1;
+
+  btnArmed &= delta & ~flip;   // rebote o flanco ya emitido → rearmar
+  if (!flip) return;
+
+  uint16_t stable = btnStable ^ flip;
+  btnStable = stable;
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+    uint16_t b = 1u << i;
+    if (flip & b) btnQueue.push(BtnEvent{ i, (bool)(stable & b), btnEdgeUs[i] });
+  }
 }
 
-bool isGameCompleted() {
-  // Todos los botones correctos deben estar presionados
-  for (unsigned char k=0; k<NUM_CORRECT; k++) 
-    if (!buttonState[CORRECT_BUTTONS[k]]) return false;
-  
-  // Ningún botón incorrecto debe estar presionado
-  for (unsigned char i=0; i<NUM_BUTTONS; i++) 
-    if (!isButtonInCorrect(i) && buttonState[i]) return false;
-  
-  return true;
+ISR(INT0_vect) { btnEdge(1u << 0); }
+ISR(INT1_vect) { btnEdge(1u << 1); }
+ISR(INT2_vect) { btnEdge(1u << 2); }
+ISR(INT3_vect) { btnEdge(1u << 3); }
+ISR(INT4_vect) { btnEdge(1u << 8); }
+ISR(INT5_vect) { btnEdge(1u << 9); }
+ISR(PCINT1_vect) { btnEdge(btnPcintMask); }
+
+ISR(TIMER0_COMPB_vect) {
+  if (++btnTick < BTN_SAMPLE_TICKS) return;
+  btnTick = 0;
+  btnSample();
+}
+
+void inputCaptureInit() {
+  btnStable = ~ButtonPins::read() & BTN_MASK_ALL;
+
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+    uint8_t pin = ButtonPins::pins[i];
+
+    int8_t n = BTN_EXT_INT[i];
+    if (n >= 0) {
+      // ISCn1:ISCn0 = 01 → interrupción en cualquier cambio
+      if (n < 4) EICRA = (EICRA & ~(3 << (2 * n))) | (1 << (2 * n));
+      else       EICRB = (EICRB & ~(3 << (2 * (n - 4)))) | (1 << (2 * (n - 4)));
+      EIFR = 1 << n;
+      EIMSK |= 1 << n;
+    } else if (digitalPinToPCICR(pin)) {
+      *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+      PCIFR = bit(digitalPinToPCICRbit(pin));
+      PCICR |= bit(digitalPinToPCICRbit(pin));
+      btnPcintMask |= 1u << i;
+    }
+  }
+
+  // Timer0 corre libre (millis); COMPB dispara una vez por vuelta
+  OCR0B = 128;
+  TIMSK0 |= _BV(OCIE0B);
 }
 
 bool scanButtons(bool& completedNow) {
   bool anyChange = false;
   completedNow = false;
-  
-  static unsigned long lastScan = 0;
-  if (millis() - lastScan < 5) return false;
-  lastScan = millis();
 
-  // Leer cada botón con debounce
-  for (int i=0; i<NUM_BUTTONS; i++) {
-    bool pressedNow = (digitalRead(buttonPins[i]) == LOW);  // PULLUP → LOW = presionado
+  // Consumir los flancos ya sin rebotes
+  BtnEvent ev;
+  while (btnQueue.pop(ev)) {
+    uint8_t i = ev.btn;
+    if (!ev.pressed) continue;         // la suelta no cambia el estado
+
+    buttonState ^= 1u << i;            // toggle
+    lastPressedButton = i;
+    lastPressedUs = ev.us;
+    anyChange = true;
     
-    if (pressedNow && (millis() - debounceTime[i] > DEBOUNCE_MS)) {
-      debounceTime[i] = millis();
-      buttonState[i] = !buttonState[i];  // toggle
-      lastPressedButton = i;
-      anyChange = true;
-      
-      // Actualizar LED del botón
-      digitalWrite(ledPinsBtn[i], buttonState[i] ? HIGH : LOW);
-      
-      #if DEBUG
-        Serial.print(F("🔘 Botón ")); Serial.print(i+1);
-        Serial.print(F(" → ")); Serial.println(buttonState[i] ? F("ON") : F("OFF"));
-      #endif
-    }
+    #if DEBUG
+      Serial.print(F("🔘 Botón ")); Serial.print(i+1);
+      Serial.print(F(" → ")); Serial.print((buttonState & (1u << i)) ? F("ON") : F("OFF"));
+      Serial.print(F(" @")); Serial.print(ev.us); Serial.println(F("us"));
+    #endif
   }
 
+  // LEDs de los botones: una escritura por puerto
+  if (anyChange) ButtonLeds::write(buttonState);
+
   // Verificar completitud
   completedNow = isGameCompleted();
   if (completedNow) {
-    digitalWrite(LED_GAME, HIGH);
+    FastPin<LED_GAME>::high();
     DBG(F("✅ JUEGO COMPLETADO - Esperando restart"));
   }
 
@@ -220,8 +349,24 @@ const char* ARDUINO_ID = "buttons-arduino";
 const char* CONNECT_PATH = "/connect";
 const char* DISPATCH_PATH = "/dispatch";
 
-// Keep-alive connection
-EthernetClient backendConn;
+// Transporte de los eventos (ver udp_telemetry.h): 0 = POST /dispatch por
+// HTTP keep-alive, 1 = datagramas UDP al TELEMETRY_PORT del servidor
+#define DISPATCH_UDP 0
+// Con DISPATCH_UDP: 1 = completados por UDP con ACK, 0 = completados por HTTP
+#define DISPATCH_UDP_ACK 1
+const uint16_t TELEMETRY_PORT = 3002;
+
+// Conexión keep-alive para /dispatch (ver backend_client.h)
+BackendClient backend(serverIp, serverPort);
+
+// Cola de salida de /dispatch: en orden, con reintentos (ver dispatch_queue.h)
+void onDispatchDone(bool ok);
+DispatchQueue<6> outbox(backend, DISPATCH_PATH, onDispatchDone);
+void onDispatchDone(bool ok) { outbox.done(ok); }
+
+#if DISPATCH_UDP
+UdpTelemetry telemetry(serverIp, TELEMETRY_PORT);
+#endif
 
 void networkInit() {
   pinMode(ETH_CS, OUTPUT);
@@ -234,14 +379,19 @@ void networkInit() {
   Ethernet.begin(mac, ipFallback, dnsServer, gateway, subnet);
   
   controlServer.begin();
+
+#if DISPATCH_UDP
+  telemetry.begin(TELEMETRY_PORT);
+  outbox.useUdp(&telemetry, DISPATCH_UDP_ACK);
+#endif
 }
 
 bool isNetworkConnected() { return connectedOK; }
 
 void setStatusLeds(bool red, bool yellow, bool green) {
-  digitalWrite(LED_ROJO, red ? HIGH : LOW);
-  digitalWrite(LED_AMARILLO, yellow ? HIGH : LOW);
-  digitalWrite(LED_VERDE, green ? HIGH : LOW);
+  FastPin<LED_ROJO>::write(red);
+  FastPin<LED_AMARILLO>::write(yellow);
+  FastPin<LED_VERDE>::write(green);
 }
 
 void scheduleReconnectSoon() {
@@ -256,6 +406,7 @@ void onServerConnected() {
   connectedOK = true;
   nextReconnectMs = 0;
   lastPingReceivedMs = millis();
+  outbox.resume();   // vaciar lo que se acumuló sin conexión
   DBG(F("✅ Conexión servidor establecida/recuperada"));
 }
 
@@ -265,63 +416,24 @@ void onServerDisconnected() {
   DBG(F("❌ Desconectado del servidor"));
 }
 
-bool postJsonToServer(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(50);
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP para POST"));
-    return false;
-  }
-  
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-  
-  // No esperamos respuesta, cerramos inmediatamente
-  cli.stop();
-  return true;
-}
+// ====== /connect asíncrono (ver backend_client.h) ======
+// handleReconnection() encola el /connect y el resultado llega a
+// onConnectDone() desde networkUpdate(): un servidor caído ya no congela
+// el escaneo de botones ni la atención de /ping
+bool connectInFlight = false;
 
-bool postJsonToServerWaitResponse(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(150);
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP para POST"));
-    return false;
+void onConnectDone(bool ok) {
+  connectInFlight = false;
+  if (ok) {
+    onServerConnected();
+    // Iniciar el juego automáticamente al (re)conectar
+    if (!isGameRunning()) {
+      gameStart();
+      DBG(F("🎮 Juego iniciado tras conexión"));
+    }
+  } else {
+    scheduleReconnectLater();
   }
-  
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-
-  // Esperamos respuesta del servidor
-  unsigned long t0 = millis();
-  while (cli.connected() && millis() - t0 < 50)
-    while (cli.available()) cli.read();
-  cli.stop();
-  return true;
 }
 
 bool sendConnect() {
@@ -330,10 +442,9 @@ bool sendConnect() {
   String body = "{\"id\":\"" + String(ARDUINO_ID) + "\",\"ip\":\"" + myIp + "\",\"port\":" + String(ARD_PORT) + "}";
   
   DBG(F("📤 /connect:")); DBG(body);
-  bool result = postJsonToServerWaitResponse(CONNECT_PATH, body);
-  if (result) onServerConnected();
-  else onServerDisconnected();
-  return result;
+  connectInFlight = backend.post(CONNECT_PATH, body, onConnectDone);
+  if (!connectInFlight) scheduleReconnectLater();
+  return connectInFlight;
 }
 
 void checkPingTimeout() {
@@ -344,22 +455,13 @@ void checkPingTimeout() {
 }
 
 void handleReconnection() {
-  if (!connectedOK && (long)(millis() - nextReconnectMs) >= 0) {
+  if (!connectedOK && !connectInFlight && (long)(millis() - nextReconnectMs) >= 0) {
     DBG(F("↻ Intentando /connect..."));
-    if (sendConnect()) {
-      onServerConnected();
-      // Iniciar el juego automáticamente al reconectar
-      if (!isGameRunning()) {
-        gameStart();
-        DBG(F("🎮 Juego iniciado tras reconexión"));
-      }
-    } else {
-      scheduleReconnectLater();
-    }
+    sendConnect();
   }
 }
 
-bool sendDispatchEvent(const char* eventName, const bool state[], int lastPressed, bool completed) {
+bool sendDispatchEvent(const char* eventName, uint16_t state, int lastPressed, bool completed) {
   String body;
   body.reserve(320);
 
@@ -370,7 +472,7 @@ bool sendDispatchEvent(const char* eventName, const bool state[], int lastPresse
   body += "\"buttons\":[";
   for (int i = 0; i < NUM_BUTTONS; i++) {
     body += "{\"id\":"; body += (i+1); body += ",\"pressed\":";
-    body += (state[i] ? "true" : "false"); body += "}";
+    body += ((state & (1u << i)) ? "true" : "false"); body += "}";
     if (i < NUM_BUTTONS-1) body += ",";
   }
   body += "],";
@@ -381,7 +483,7 @@ bool sendDispatchEvent(const char* eventName, const bool state[], int lastPresse
   body += "}}";
 
   DBG(F("📤 /dispatch:")); DBG(body);
-  return postJsonToServer(DISPATCH_PATH, body);
+  return outbox.push(body, completed, eventName);
 }
 
 String getUptimeISO8601() {
@@ -462,6 +564,44 @@ void handlePingRequest(EthernetClient& c, const String& path) {
   }
 }
 
+void handleStatsRequest(EthernetClient& c, const String& path) {
+  c.println(F("HTTP/1.1 200 OK"));
+  c.println(F("Content-Type: application/json; charset=utf-8"));
+  c.println(F("Connection: close"));
+  c.println();
+  c.print(F("{\"input\":{\"drops\":")); c.print(btnQueue.drops());
+  c.print(F(",\"maxDepth\":")); c.print(btnQueue.maxDepth());
+  c.print(F(",\"queueSize\":")); c.print(btnQueue.capacity());
+  c.print(F(",\"debounceUs\":")); c.print(BTN_DEBOUNCE_US);
+  c.print(F(",\"lastPressed\":")); c.print(lastPressedButton + 1);
+  c.print(F(",\"lastPressedUs\":")); c.print(lastPressedUs);
+  c.print(F("},\"rules\":"));
+  rules.printJson(c);
+  c.print(F(",\"outbox\":"));
+  outbox.printJson(c);
+#if DISPATCH_UDP
+  c.print(F(",\"udp\":"));
+  telemetry.printStats(c);
+#endif
+  c.print(F(",\"backend\":"));
+  backend.printStats(c);
+  c.print(F(",\"sched\":"));
+  sched.printStats(c);
+  c.println('}');
+  c.stop();
+
+  // GET /stats?reset=1 reinicia contadores y máximos
+  if (path.indexOf("reset=1") >= 0) {
+    sched.resetStats();
+    btnQueue.resetMaxDepth();
+    backend.resetStats();
+    outbox.resetStats();
+#if DISPATCH_UDP
+    telemetry.resetStats();
+#endif
+  }
+}
+
 void handleControlGet(EthernetClient& c, const String& path) {
   sendHttpResponse400(c, F("Use POST /control"));
   c.stop();
@@ -494,8 +634,14 @@ void handleControlPost(EthernetClient& c) {
   } else if (body.indexOf("\"command\":\"stop\"") >= 0) {
     gameStop();
     sendHttpResponse200(c, "stop");
+  } else if (body.indexOf("\"command\":\"rule\"") >= 0) {
+    if (rules.loadJson(body)) sendHttpResponse200(c, "rule");
+    else sendHttpResponse400(c, F("Regla invalida: {\"command\":\"rule\",\"required\":[1,3],\"forbidden\":[2],\"slot\":0}"));
+  } else if (body.indexOf("\"command\":\"outbox\"") >= 0) {
+    if (outbox.loadJson(body)) sendHttpResponse200(c, "outbox");
+    else sendHttpResponse400(c, F("Cola invalida: {\"command\":\"outbox\",\"coalesceMs\":20,\"rateMs\":100,\"burst\":4}"));
   } else {
-    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart\"}"));
+    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart|rule|outbox\"}"));
   }
   
   c.stop();
@@ -522,6 +668,8 @@ void handleLocalServerRequest() {
 
     if (method == "GET" && (path.startsWith("/Ping") || path.startsWith("/ping"))) {
       handlePingRequest(c, path);
+    } else if (method == "GET" && path.startsWith("/stats")) {
+      handleStatsRequest(c, path);
     } else if (method == "GET" && path.startsWith("/control")) {
       handleControlGet(c, path);
     } else if (method == "POST" && path == "/control") {
@@ -534,6 +682,11 @@ void handleLocalServerRequest() {
 }
 
 void networkUpdate() {
+#if DISPATCH_UDP
+  telemetry.poll();
+#endif
+  outbox.pump(connectedOK);
+  backend.poll();
   handleLocalServerRequest();
   checkPingTimeout();
   handleReconnection();
@@ -553,11 +706,10 @@ void setupHardware() {
   digitalWrite(LED_READY, LOW);
   setStatusLeds(false, false, false);
 
-  for (int i=0; i<NUM_BUTTONS; i++) pinMode(buttonPins[i], INPUT_PULLUP);
-  for (int i=0; i<NUM_BUTTONS; i++) {
-    pinMode(ledPinsBtn[i], OUTPUT);
-    digitalWrite(ledPinsBtn[i], LOW);
-  }
+  ButtonPins::mode(INPUT_PULLUP);
+  inputCaptureInit();
+  ButtonLeds::mode(OUTPUT);
+  ButtonLeds::write(0);
 }
 
 void updateSystemStatus() {
@@ -569,50 +721,137 @@ void updateSystemStatus() {
     setStatusLeds(false, false, true);    // 🟢 ejecutando
 }
 
+#if GPIO_BENCH
+// ====== BENCHMARK GPIO ======
+// Timer1 sin prescaler cuenta ciclos de CPU. Se descuenta la llamada vacía.
+volatile uint16_t benchSink;
+
+void benchEmpty() {}
+
+void benchReadCore() {
+  static const uint8_t pins[NUM_BUTTONS] = {21,20,19,18,17,16,15,14,2,3};
+  uint16_t m = 0;
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++)
+    if (digitalRead(pins[i]) == LOW) m |= 1u << i;
+  benchSink = m;
+}
+
+void benchReadFast() {
+  benchSink = ~ButtonPins::read() & BTN_MASK_ALL;
+}
+
+void benchLedsCore() {
+  digitalWrite(LED_ROJO, LOW);
+  digitalWrite(LED_AMARILLO, HIGH);
+  digitalWrite(LED_VERDE, LOW);
+}
+
+void benchLedsFast() {
+  setStatusLeds(false, true, false);
+}
+
+uint16_t benchCycles(void (*fn)()) {
+  uint8_t a = TCCR1A, b = TCCR1B;
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  fn();
+  uint16_t t = TCNT1;
+  TCCR1A = a;
+  TCCR1B = b;
+  interrupts();
+  return t;
+}
+
+void gpioBenchmark() {
+  uint16_t base = benchCycles(benchEmpty);
+  Serial.println(F("⏱️ Ciclos de CPU (core → fast_gpio):"));
+  Serial.print(F("   scanButtons, lectura 10 pines:  "));
+  Serial.print(benchCycles(benchReadCore) - base); Serial.print(F(" → "));
+  Serial.println(benchCycles(benchReadFast) - base);
+  Serial.print(F("   updateSystemStatus, 3 LEDs:     "));
+  Serial.print(benchCycles(benchLedsCore) - base); Serial.print(F(" → "));
+  Serial.println(benchCycles(benchLedsFast) - base);
+}
+#endif
+
+// ====== TAREAS ======
+// net      : cada pasada, prioridad máxima
+// buttons  : cada 5ms (cuenta READY + escaneo)
+// dispatch : por evento, lo levanta buttons cuando hay cambios
+// leds     : cada 50ms
+const unsigned long BUTTONS_PERIOD_US = 5000;
+const unsigned long LEDS_PERIOD_US    = 50000;
+
+void taskNetwork() {
+  networkUpdate();
+}
+
+void taskButtons() {
+  // Fuera de juego / durante READY las pulsaciones capturadas se descartan
+  if (!isGameRunning() || !readyCountdownFinished()) {
+    btnQueue.clear();
+    return;
+  }
+
+  bool completedNow = false;
+  if (scanButtons(completedNow)) {
+    dispatchCompleted |= completedNow;
+    sched.signal(taskDispatch);
+  }
+
+  if (completedNow) {
+    gameStop();
+    FastPin<LED_GAME>::high();
+    Serial.println(F("🎉 JUEGO COMPLETADO - Esperando restart"));
+  }
+}
+
+void taskDispatchState() {
+  // Se encola también sin conexión: sale en orden al reconectar
+  sendDispatchEvent("buttons:state-changed",
+                    buttonState,
+                    getLastPressed(),
+                    dispatchCompleted);
+  dispatchCompleted = false;
+}
+
+void setupTasks() {
+  //        nombre          función             tipo             prio período            presupuesto
+  sched.add(F("net"),      taskNetwork,        TASK_EVERY_PASS, 0,   0,                  5000);
+  sched.add(F("buttons"),  taskButtons,        TASK_PERIODIC,   1,   BUTTONS_PERIOD_US,  1000);
+  taskDispatch =
+  sched.add(F("dispatch"), taskDispatchState,  TASK_EVENT,      2,   0,                  20000);
+  sched.add(F("leds"),     updateSystemStatus, TASK_PERIODIC,   3,   LEDS_PERIOD_US,     200);
+}
+
 void setup() {
   Serial.begin(115200);
   
   setupHardware();
+#if GPIO_BENCH
+  gpioBenchmark();
+#endif
   gameInit();
   networkInit();
 
-  if (sendConnect()) {
+  // En setup sí se espera a que termine el /connect (el juego arranca
+  // desde onConnectDone)
+  sendConnect();
+  while (backend.busy()) backend.poll();
+
+  if (connectedOK) {
     DBG(F("✅ Conexión inicial exitosa"));
-    // Iniciar el juego automáticamente al conectar
-    gameStart();
-    DBG(F("🎮 Juego iniciado automáticamente"));
   } else {
     DBG(F("❌ Fallo en conexión inicial"));
   }
 
   updateSystemStatus();
+  setupTasks();
 }
 
 void loop() {
-  // 1. Actualizar interfaz de red (siempre máxima prioridad)
-  networkUpdate();
-
-  // 2. Lógica del juego (solo si está corriendo)
-  if (isGameRunning()) {
-    if (!readyCountdownFinished()) return;
-
-    bool completedNow = false;
-    if (scanButtons(completedNow)) {
-      if (isNetworkConnected()) {
-        sendDispatchEvent("buttons:state-changed", 
-                         buttonState, 
-                         getLastPressed(), 
-                         completedNow);
-      }
-    }
-
-    if (completedNow) {
-      gameStop();
-      digitalWrite(LED_GAME, HIGH);
-      Serial.println(F("🎉 JUEGO COMPLETADO - Esperando restart"));
-    }
-  }
-
-  // 3. Actualizar LEDs de estado
-  updateSystemStatus();
-}
\ No newline at end of file
+  // Red, escaneo, dispatch y LEDs van como tareas con su propio ritmo
+  sched.run();
+}
@@ -0,0 +1,342 @@
+// ============================================================
+// CLIENTE HTTP/1.1 KEEP-ALIVE Y ASÍNCRONO hacia el backend (POST JSON)
+//  - post() solo encola (sin E/S); poll() avanza la máquina de estados una
+//    pasada cada vez:
+//      CLOSED → CONNECT → SEND → AWAIT → READY → (SEND ... | CLOSED)
+//    con plazo por estado (connect, respuesta, inactividad). El resultado
+//    de cada POST llega por su done(ok): ok = respuesta 2xx
+//  - Una sola conexión TCP que se reutiliza entre POST: sin handshake ni
+//    FIN por evento. Si se cae, se reconecta y se reintenta una vez el POST
+//    que no llegó a tener respuesta
+//  - Se cierra sola tras KA_IDLE_MS sin uso, por debajo del keepAliveTimeout
+//    de Node (5 s), para no escribir nunca en un socket que el servidor
+//    está cerrando
+//  - Un POST en vuelo cada vez; los demás esperan en una cola de
+//    KA_QUEUE_LEN y salen en orden
+//  - BLOQUEANTE: CONNECT es el único estado que espera. El connect() de
+//    EthernetENC no se puede partir entre pasadas (la conexión uIP es
+//    privada de la librería y al vencer el plazo la cierra), así que esa
+//    pasada bloquea el loop() hasta KA_CONNECT_MS (300 ms) más un tick de
+//    la librería (leer una trama del ENC28J60, ~2 ms). En la LAN con el
+//    servidor levantado termina en pocos ms; /stats → maxConnectMs guarda
+//    el peor visto
+//  - Si falla, los intentos se espacian con backoff exponencial
+//    (KA_BACKOFF_MIN_MS..KA_BACKOFF_MAX_MS): con el servidor caído el loop
+//    pierde 300 ms por intento, primero cada ~0.5 s y después como mucho
+//    uno cada ~8.3 s, no en cada evento
+// Uso:
+//   BackendClient backend(serverIp, serverPort);
+//   backend.post("/dispatch", body);            // o con done(ok)
+//   void networkUpdate() { backend.poll(); ... }
+// ============================================================
+
+#ifndef BACKEND_CLIENT_H
+#define BACKEND_CLIENT_H
+
+#include <Arduino.h>
+#include <EthernetENC.h>
+#include <string.h>
+
+#ifndef KA_QUEUE_LEN
+#define KA_QUEUE_LEN 4
+#endif
+
+const uint16_t KA_CONNECT_MS = 300;          // lo que puede bloquear el loop() un connect()
+const unsigned long KA_RESPONSE_MS = 2000;   // plazo de la respuesta
+const unsigned long KA_IDLE_MS = 4000;       // < keepAliveTimeout de Node (5000)
+const unsigned long KA_BACKOFF_MIN_MS = 250;
+const unsigned long KA_BACKOFF_MAX_MS = 8000;
+
+typedef void (*HttpDoneFn)(bool ok);
+
+enum HttpState : uint8_t {
+  HTTP_CLOSED,    // sin conexión
+  HTTP_CONNECT,   // abrir la conexión TCP
+  HTTP_SEND,      // escribir el POST de la cabeza de la cola
+  HTTP_AWAIT,     // esperando status + cabeceras + cuerpo
+  HTTP_READY      // conexión abierta y ociosa
+};
+
+struct BackendStats {
+  unsigned long requests;     // POST escritos
+  unsigned long reused;       // ...de ellos, por una conexión ya usada
+  unsigned long connects;     // conexiones TCP abiertas
+  unsigned long connectFails; // connect() fallidos
+  unsigned long retries;      // reenvíos tras caerse la conexión
+  unsigned long failures;     // POST terminados con done(false)
+  unsigned long rejected;     // post() con la cola llena
+  unsigned long responses;    // respuestas completas recibidas
+  unsigned long maxConnectMs; // connect() más largo (lo que se bloqueó el loop)
+  uint16_t lastStatus;        // último código HTTP
+};
+
+class BackendClient {
+public:
+  BackendClient(const IPAddress &ip, uint16_t port)
+    : ip(ip), port(port), state(HTTP_CLOSED), stateMs(0), retryAt(0),
+      backoffMs(0), connUses(0), qHead(0), qCount(0), ps(PS_STATUS),
+      lineLen(0), status(0), bodyLeft(0), serverClose(false), gotBytes(false) {
+    memset(&st, 0, sizeof(st));
+  }
+
+  // Encola el POST. false si la cola está llena (done no se llamará)
+  bool post(const char *path, const String &body, HttpDoneFn done = nullptr) {
+    if (qCount >= KA_QUEUE_LEN) {
+      st.rejected++;
+      return false;
+    }
+    Request &r = q[(qHead + qCount) % KA_QUEUE_LEN];
+    r.path = path;
+    r.body = body;
+    r.done = done;
+    r.tries = 0;
+    qCount++;
+    return true;
+  }
+
+  // Una pasada de la máquina de estados
+  void poll() {
+    unsigned long now = millis();
+    switch (state) {
+      case HTTP_CLOSED:
+        if (qCount && (long)(now - retryAt) >= 0) enter(HTTP_CONNECT);
+        break;
+
+      case HTTP_CONNECT: {
+        cli.setConnectionTimeout(KA_CONNECT_MS);
+        bool ok = cli.connect(ip, port);
+        unsigned long took = millis() - now;
+        if (took > st.maxConnectMs) st.maxConnectMs = took;
+        if (ok) {
+          st.connects++;
+          backoffMs = 0;
+          connUses = 0;
+          enter(HTTP_SEND);
+        } else {
+          st.connectFails++;
+          backoffMs = backoffMs ? backoffMs * 2 : KA_BACKOFF_MIN_MS;
+          if (backoffMs > KA_BACKOFF_MAX_MS) backoffMs = KA_BACKOFF_MAX_MS;
+          retryAt = millis() + backoffMs;
+          enter(HTTP_CLOSED);
+          failAll();   // servidor inalcanzable: no se acumulan eventos viejos
+        }
+        break;
+      }
+
+      case HTTP_SEND:
+        if (!qCount) { enter(HTTP_READY); break; }
+        if (!cli.connected()) { connectionLost(); break; }
+        if (writeHead()) {
+          st.requests++;
+          if (connUses++) st.reused++;
+          resetParser();
+          enter(HTTP_AWAIT);
+        } else {
+          connectionLost();
+        }
+        break;
+
+      case HTTP_AWAIT: {
+        int n = cli.available();
+        while (n-- > 0 && state == HTTP_AWAIT) {
+          int ch = cli.read();
+          if (ch < 0) break;
+          gotBytes = true;
+          feed((char)ch);
+        }
+        if (state != HTTP_AWAIT) break;
+        if (!cli.connected()) {
+          connectionLost();
+        } else if (now - stateMs >= KA_RESPONSE_MS) {
+          disconnect();    // sin respuesta: la conexión ya no es fiable
+          finish(false);
+        }
+        break;
+      }
+
+      case HTTP_READY:
+        if (!cli.connected()) disconnect();
+        else if (qCount) enter(HTTP_SEND);
+        else if (now - stateMs >= KA_IDLE_MS) disconnect();
+        break;
+    }
+  }
+
+  // Cierra la conexión y descarta la cola (done(false) para cada POST)
+  void close() {
+    if (state != HTTP_CLOSED && state != HTTP_CONNECT) cli.stop();
+    enter(HTTP_CLOSED);
+    failAll();
+  }
+
+  HttpState getState() const { return state; }
+  bool connected() const { return state >= HTTP_SEND; }
+  uint8_t pending() const { return qCount; }
+  bool busy() const { return qCount > 0; }
+  const BackendStats &stats() const { return st; }
+
+  // {"state":..,"pending":..,"requests":..,...}
+  void printStats(Print &out) const {
+    static const char *const NAMES[] = { "closed", "connect", "send", "await", "ready" };
+    out.print(F("{\"state\":\"")); out.print(NAMES[state]);
+    out.print(F("\",\"pending\":")); out.print(qCount);
+    out.print(F(",\"requests\":")); out.print(st.requests);
+    out.print(F(",\"reused\":")); out.print(st.reused);
+    out.print(F(",\"connects\":")); out.print(st.connects);
+    out.print(F(",\"connectFails\":")); out.print(st.connectFails);
+    out.print(F(",\"maxConnectMs\":")); out.print(st.maxConnectMs);
+    out.print(F(",\"backoffMs\":")); out.print(backoffMs);
+    out.print(F(",\"retries\":")); out.print(st.retries);
+    out.print(F(",\"failures\":")); out.print(st.failures);
+    out.print(F(",\"rejected\":")); out.print(st.rejected);
+    out.print(F(",\"responses\":")); out.print(st.responses);
+    out.print(F(",\"lastStatus\":")); out.print(st.lastStatus);
+    out.print('}');
+  }
+
+  void resetStats() { memset(&st, 0, sizeof(st)); }
+
+private:
+  struct Request {
+    const char *path;
+    String body;
+    HttpDoneFn done;
+    uint8_t tries;     // reenvíos ya hechos
+  };
+
+  enum ParseState : uint8_t { PS_STATUS, PS_HEADERS, PS_BODY };
+
+  void enter(HttpState s) {
+    state = s;
+    stateMs = millis();
+  }
+
+  void disconnect() {
+    cli.stop();
+    enter(HTTP_CLOSED);
+  }
+
+  // La conexión se cayó con el POST de cabeza escrito o por escribir. Si no
+  // llegó ni un byte de respuesta se reintenta una vez por otra conexión
+  // (típico: el servidor cerró la keep-alive justo antes)
+  void connectionLost() {
+    bool answered = state == HTTP_AWAIT && gotBytes;
+    disconnect();
+    if (!qCount) return;
+    if (!answered && q[qHead].tries == 0) {
+      q[qHead].tries++;
+      st.retries++;
+      retryAt = millis();
+    } else {
+      finish(false);
+    }
+  }
+
+  bool writeHead() {
+    const Request &r = q[qHead];
+    String req;
+    req.reserve(r.body.length() + 140);
+    req += F("POST "); req += r.path; req += F(" HTTP/1.1\r\nHost: ");
+    req += ip[0]; req += '.'; req += ip[1]; req += '.'; req += ip[2]; req += '.'; req += ip[3];
+    req += ':'; req += port;
+    req += F("\r\nUser-Agent: Arduino\r\nContent-Type: application/json\r\nContent-Length: ");
+    req += r.body.length();
+    req += F("\r\nConnection: keep-alive\r\n\r\n");
+    req += r.body;
+    size_t len = req.length();
+    return cli.write((const uint8_t *)req.c_str(), len) == len;
+  }
+
+  // Saca la cabeza de la cola y avisa (done puede volver a llamar a post)
+  void finish(bool ok) {
+    if (!qCount) return;
+    Request &r = q[qHead];
+    HttpDoneFn done = r.done;
+    r.body = String();
+    qHead = (qHead + 1) % KA_QUEUE_LEN;
+    qCount--;
+    if (!ok) st.failures++;
+    if (done) done(ok);
+  }
+
+  void failAll() {
+    uint8_t n = qCount;   // lo que se encole desde un done() se conserva
+    while (n--) finish(false);
+  }
+
+  void resetParser() {
+    ps = PS_STATUS;
+    lineLen = 0;
+    status = 0;
+    bodyLeft = 0;
+    serverClose = false;
+    gotBytes = false;
+  }
+
+  // Respuesta entera: la conexión queda libre y se avisa a su POST
+  void responseDone() {
+    st.responses++;
+    st.lastStatus = status;
+    if (serverClose) disconnect();
+    else enter(HTTP_READY);
+    finish(status >= 200 && status < 300);
+  }
+
+  void feed(char ch) {
+    if (ps == PS_BODY) {
+      if (--bodyLeft == 0) responseDone();
+      return;
+    }
+    if (ch == '\r') return;
+    if (ch != '\n') {
+      if (lineLen < sizeof(line) - 1) line[lineLen++] = ch;
+      return;
+    }
+
+    line[lineLen] = '\0';
+    if (ps == PS_STATUS) {
+      if (lineLen == 0) return;   // CRLF suelto entre respuestas
+      // "HTTP/1.1 200 OK"
+      const char *sp = strchr(line, ' ');
+      status = sp ? atoi(sp + 1) : 0;
+      bodyLeft = 0;
+      ps = PS_HEADERS;
+    } else if (lineLen == 0) {
+      if (bodyLeft > 0) ps = PS_BODY;
+      else responseDone();
+    } else if (strncasecmp(line, "content-length:", 15) == 0) {
+      bodyLeft = atol(line + 15);
+    } else if (strncasecmp(line, "connection:", 11) == 0) {
+      serverClose = strcasestr(line + 11, "close") != nullptr;
+    }
+    lineLen = 0;
+  }
+
+  EthernetClient cli;
+  IPAddress ip;
+  uint16_t port;
+
+  HttpState state;
+  unsigned long stateMs;     // entrada en el estado actual (plazos)
+  unsigned long retryAt;     // próximo connect permitido
+  unsigned long backoffMs;
+  uint8_t connUses;          // POST escritos por la conexión actual
+
+  // Cola de POST; la cabeza es el que está en vuelo
+  Request q[KA_QUEUE_LEN];
+  uint8_t qHead;
+  uint8_t qCount;
+
+  // Parser incremental de la respuesta
+  ParseState ps;
+  char line[40];   // las cabeceras que interesan caben; el resto se trunca
+  uint8_t lineLen;
+  uint16_t status;
+  long bodyLeft;
+  bool serverClose;
+  bool gotBytes;
+
+  BackendStats st;
+};
+
+#endif
@@ -3,13 +3,19 @@
 //  - ENC28J60 (CS = D46)  **no uses D46 para LEDs**
 //  - LEDs: D5 rojo (sin conexión), D6 amarillo (pausado/latcheado),
 //          D7 verde (midiendo), D9 LED del juego al completar
-//  - Envía /dispatch SOLO cuando completed=true (una sola vez)
+//  - Envía /dispatch con completed=true una sola vez y, mientras se juega,
+//    connections:progress con los cables que cambiaron (máx. cada 250ms)
 //  - Tras completar: espera {"command":"restart"} por POST /control
 //  - Reconexión por timeout de ping
 // ============================================================
 
 #include <SPI.h>
 #include <EthernetENC.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <EEPROM.h>
+#include <stddef.h>
 
 // ====== CONFIGURACIÓN ======
 #define DEBUG 1
@@ -21,16 +27,36 @@
   #define DBGF(...) do{}while(0)
 #endif
 
+// Bus del ENC28J60: 0 = SPI compartido, 1 = USART1 en modo SPI (ver eth_spi.h)
+#define ETH_SPI_USART1 0
+#include "eth_spi.h"
+
+#include "scheduler.h"
+#include "fast_gpio.h"
+#include "coro.h"
+#include "backend_client.h"
+#include "dispatch_queue.h"
+#include "adc_windows.h"
+
 // ============================================================
 // SECCIÓN 1: CONFIGURACIÓN HARDWARE Y JUEGO
 // ============================================================
 
 // ===== JUEGO: CABLES (A0–A4) =====
-const int   N_SAMPLES = 10;
-const float RREF      = 20000.0f;
-const uint8_t APIN[5] = { A0, A1, A2, A3, A4 };
-const float R_MIN[5]  = { 3250, 4750, 6750, 9800, 15100 };
-const float R_MAX[5]  = { 3390, 4880, 6850, 10200, 15300 };
+#define NUM_CABLES 5
+const uint8_t ADC_MEDIAN_N = 5;   // conversiones por canal y ronda (se toma la mediana)
+const uint8_t ADC_EMA_SHIFT = 2;  // EMA: alfa = 1/4 por ronda
+const uint8_t ADC_HYST = 2;       // códigos de margen para SALIR de la ventana
+const uint16_t ADC_OPEN = 1000;   // por encima: cable suelto (R > ~870k)
+
+// 1 = medir en modo ADC Noise Reduction: CPU y reloj de E/S parados durante
+// cada conversión. Ojo: Timer0 también se para, así que millis()/micros()
+// pierden ~3ms por ronda; en este modo se mide una ronda por ejecución de
+// la tarea de cables y el período se alarga.
+#define ADC_NOISE_SLEEP 0
+const uint8_t APIN[NUM_CABLES] = { A0, A1, A2, A3, A4 };
+
+// Ventanas en ohmios (RREF, R_MIN, R_MAX): ver adc_windows.h
 
 // LEDs de estado
 #define LED_ROJO     5
@@ -45,26 +71,355 @@ const float R_MAX[5]  = { 3390, 4880, 6850, 10200, 15300 };
 bool gameRunning    = true;   // si quieres que espere START, pon false
 bool completedLatch = false;
 
+// Estado de cada cable, 2 bits por canal (bits 2i..2i+1 = cable i)
+enum CableState : uint8_t { CABLE_OPEN, CABLE_WRONG, CABLE_OK, CABLE_UNKNOWN };
+const uint16_t CABLE_STATES_UNKNOWN = 0x3FF;   // los 5 en CABLE_UNKNOWN
+uint16_t cableStates = 0;
+uint16_t cableStatesSent = CABLE_STATES_UNKNOWN;     // lo último que confirmó el servidor
+uint16_t cableStatesQueued = CABLE_STATES_UNKNOWN;   // lo que lleva el último progreso encolado
+uint8_t progressEpoch = 0;   // cambia en cada progressReset()
+
+// Tag del progreso en la cola de salida: estados (10 bits) + epoch (6 bits).
+// Un POST encolado antes de un reset vuelve con otro epoch y se ignora
+const uint8_t PROGRESS_EPOCH_SHIFT = 10;
+inline uint16_t progressTag(uint16_t states) {
+  return states | ((uint16_t)progressEpoch << PROGRESS_EPOCH_SHIFT);
+}
+
+// start/restart/reconexión: el siguiente progreso lleva los 5 cables
+void progressReset() {
+  cableStatesSent = CABLE_STATES_UNKNOWN;
+  cableStatesQueued = CABLE_STATES_UNKNOWN;
+  progressEpoch = (progressEpoch + 1) & 0x3F;
+}
+
+inline CableState cableState(uint16_t states, uint8_t ch) {
+  return (CableState)((states >> (2 * ch)) & 3);
+}
+
+// Planificador cooperativo (tareas registradas en setup())
+Scheduler<5> sched;
+int8_t taskDispatch = -1;
+
 // ============================================================
 // SECCIÓN 3: LÓGICA DEL JUEGO (Funciones puras)
 // ============================================================
 
-/* Utils medición */
-int avgADC(uint8_t pin) {
-  long s = 0;
-  for (int i = 0; i < N_SAMPLES; i++) {
-    s += analogRead(pin);
-    delayMicroseconds(300);
+// ====== MUESTREO ADC POR INTERRUPCIÓN ======
+// El ADC se encadena desde su propia ISR: cada conversión terminada lanza
+// la siguiente, recorriendo A0..A4 en ronda. Filtro por canal:
+//  - la 1ª conversión tras cambiar el mux se descarta (con el divisor de
+//    20k el condensador de muestreo no llega a cargarse a tiempo)
+//  - mediana de ADC_MEDIAN_N conversiones → quita picos de un contacto flojo
+//  - EMA entera (Q4, alfa = 1/2^ADC_EMA_SHIFT) sobre las medianas → quita
+//    el ruido fino; el resultado redondeado se publica en adcValue[]
+// Prescaler 128 (125kHz): ~104us por conversión → una ronda de 5 canales
+// × (1 + ADC_MEDIAN_N) ≈ 3.1ms. El loop lee adcValue[] sin esperar nunca.
+// Con ADC_NOISE_SLEEP la ISR no relanza: cada conversión arranca al dormir
+// (ver adcSleepRound()).
+volatile uint16_t adcValue[NUM_CABLES];   // valor filtrado por canal (0..1023)
+volatile uint16_t adcRounds = 0;          // rondas completas de los 5 canales
+
+// Solo ISR
+uint8_t adcCh = 0;
+uint8_t adcN = 0;                         // conversiones en el canal (0 = descartar)
+uint16_t adcBuf[ADC_MEDIAN_N];
+uint16_t adcEma[NUM_CABLES];              // Q4 (×16)
+uint8_t adcSeeded = 0;                    // bit ch = EMA ya inicializada
+
+// AVcc como referencia (= analogReference(DEFAULT)); A0..A4 = ADC0..ADC4
+inline void adcSelect(uint8_t ch) {
+  ADCSRB &= ~_BV(MUX5);
+  ADMUX = _BV(REFS0) | (APIN[ch] - A0);
+}
+
+// Mediana por inserción (N pequeño, una vez por canal y ronda)
+uint16_t adcMedian(uint16_t *b) {
+  for (uint8_t i = 1; i < ADC_MEDIAN_N; i++) {
+    uint16_t v = b[i];
+    uint8_t j = i;
+    for (; j > 0 && b[j - 1] > v; j--) b[j] = b[j - 1];
+    b[j] = v;
+  }
+  return b[ADC_MEDIAN_N / 2];
+}
+
+ISR(ADC_vect) {
+  uint16_t v = ADC;
+  if (adcN > 0) adcBuf[adcN - 1] = v;
+
+  if (++adcN > ADC_MEDIAN_N) {
+    uint16_t m = adcMedian(adcBuf) << 4;
+    uint16_t &e = adcEma[adcCh];
+    if (adcSeeded & (1 << adcCh)) e = e + ((int16_t)(m - e) >> ADC_EMA_SHIFT);
+    else { e = m; adcSeeded |= 1 << adcCh; }
+    adcValue[adcCh] = (e + 8) >> 4;
+
+    adcN = 0;
+    if (++adcCh >= NUM_CABLES) { adcCh = 0; adcRounds++; }
+    adcSelect(adcCh);
+  }
+#if !ADC_NOISE_SLEEP
+  ADCSRA |= _BV(ADSC);
+#endif
+}
+
+void adcInit() {
+  DIDR0 |= (1 << NUM_CABLES) - 1;   // sin buffer digital en A0..A4 (menos ruido)
+  adcSelect(0);
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+#if !ADC_NOISE_SLEEP
+  ADCSRA |= _BV(ADSC);
+#endif
+}
+
+
+// Última media del canal ch (lectura de 16 bits atómica, sin esperar al ADC)
+uint16_t adcRead(uint8_t ch) {
+  uint16_t v;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = adcValue[ch]; }
+  return v;
+}
+
+uint16_t adcRoundCount() {
+  uint16_t n;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { n = adcRounds; }
+  return n;
+}
+
+#if ADC_NOISE_SLEEP
+// Una ronda completa durmiendo: al entrar en SLEEP_MODE_ADC arranca la
+// conversión (si el ADC está libre) y su ISR despierta a la CPU. Si
+// despierta otra interrupción se vuelve a dormir hasta que la ronda avance;
+// dormir nunca se queda colgado porque entrar en el modo lanza conversión.
+void adcSleepRound() {
+  uint16_t start = adcRoundCount();
+  set_sleep_mode(SLEEP_MODE_ADC);
+  while (adcRoundCount() == start) {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+  }
+}
+#endif
+
+// ====== VENTANAS ADC EN COMPILACIÓN ======
+// Códigos [ADC_LO,ADC_HI] de cada ventana en ohmios (ver adc_windows.h);
+// test/adc_windows_test.cpp comprueba que coinciden con la cuenta en float
+static_assert(ADC_WINDOWS == NUM_CABLES, "una ventana por cable");
+
+const uint16_t ADC_LO[NUM_CABLES] PROGMEM = { adcLo(0), adcLo(1), adcLo(2), adcLo(3), adcLo(4) };
+const uint16_t ADC_HI[NUM_CABLES] PROGMEM = { adcHi(0), adcHi(1), adcHi(2), adcHi(3), adcHi(4) };
+
+static_assert(adcLo(0) <= adcHi(0) && adcLo(1) <= adcHi(1) && adcLo(2) <= adcHi(2) &&
+              adcLo(3) <= adcHi(3) && adcLo(4) <= adcHi(4), "ventana ADC vacía (R_MIN/R_MAX demasiado juntos)");
+
+// Ventanas en uso: las de fábrica (PROGMEM) o las calibradas en EEPROM,
+// cargadas una vez en el arranque (ver calibrationLoad())
+uint16_t winLo[NUM_CABLES];
+uint16_t winHi[NUM_CABLES];
+
+inline bool adcInWindow(uint8_t ch, uint16_t adc) {
+  return adc >= winLo[ch] && adc <= winHi[ch];
+}
+
+// Histéresis: se entra con la ventana exacta y solo se sale al alejarse
+// más de ADC_HYST códigos, así un valor en el borde no parpadea. Igual en
+// el umbral de cable suelto (ADC_OPEN), que separa "open" de "wrong"
+uint8_t cableOkMask = 0;     // bit ch = cable dentro de su ventana
+uint8_t cableOpenMask = 0;   // bit ch = cable suelto
+
+bool cableInWindow(uint8_t ch, uint16_t adc) {
+  uint8_t b = 1 << ch;
+  bool ok;
+  if (cableOkMask & b) {
+    ok = adc + ADC_HYST >= winLo[ch] && adc <= winHi[ch] + ADC_HYST;
+  } else {
+    ok = adcInWindow(ch, adc);
+  }
+  if (ok) cableOkMask |= b; else cableOkMask &= ~b;
+  return ok;
+}
+
+bool cableIsOpen(uint8_t ch, uint16_t adc) {
+  uint8_t b = 1 << ch;
+  bool open = (cableOpenMask & b) ? adc + ADC_HYST >= ADC_OPEN : adc >= ADC_OPEN;
+  if (open) cableOpenMask |= b; else cableOpenMask &= ~b;
+  return open;
+}
+
+// ====== AUTOCALIBRACIÓN (POST /control {"command":"calibrate"}) ======
+// Con los 5 cables bien puestos se toman CAL_ROUNDS rondas del ADC (una por
+// ejecución de la tarea de cables, sin bloquear) y por canal se calcula
+// media, desviación y extremos. Ventana nueva = [min(media-3σ, mín),
+// max(media+3σ, máx)] ± CAL_GUARD. Se rechaza si algún cable está suelto o
+// su media cae lejos de la ventana de fábrica (cable equivocado).
+// Se guarda en EEPROM de byte en byte (cada byte tarda ~3.3ms en escribirse;
+// uno por pasada para no parar la red). Durante la calibración y después
+// el juego queda parado: hay que mandar restart.
+// {"command":"calibrate-reset"} vuelve a las ventanas de fábrica.
+const uint8_t CAL_ROUNDS = 64;
+const uint8_t CAL_GUARD = 1;         // códigos extra a cada lado
+const uint8_t CAL_TOL_DIV = 20;      // media a ±5% de la ventana de fábrica
+const int CAL_EEPROM_ADDR = 0;
+const uint16_t CAL_MAGIC = 0xCA1B;
+static_assert(CAL_ROUNDS <= 64, "suma² de CAL_ROUNDS lecturas de 10 bits no cabe en 32 bits");
+
+struct CalData {
+  uint16_t magic;
+  uint16_t lo[NUM_CABLES];
+  uint16_t hi[NUM_CABLES];
+  uint8_t sum;                       // suma de los bytes anteriores
+};
+
+enum CalState : uint8_t { CAL_IDLE, CAL_SAMPLING, CAL_SAVING, CAL_DONE, CAL_FAILED };
+const char* const CAL_STATE_NAME[] = { "idle", "sampling", "saving", "done", "failed" };
+
+struct CalJob {
+  CalState state;
+  uint8_t rounds;
+  uint16_t lastRound;
+  uint16_t minV[NUM_CABLES];
+  uint16_t maxV[NUM_CABLES];
+  uint32_t sum[NUM_CABLES];
+  uint32_t sumSq[NUM_CABLES];
+  CalData data;
+  uint8_t saveIdx;                   // siguiente byte de data a escribir
+  bool fromEeprom;                   // ventanas en uso vienen de EEPROM
+};
+CalJob cal;
+
+uint8_t calChecksum(const CalData& d) {
+  const uint8_t* p = (const uint8_t*)&d;
+  uint8_t s = 0;
+  for (uint8_t i = 0; i < offsetof(CalData, sum); i++) s += p[i];
+  return s;
+}
+
+void calibrationDefaults() {
+  for (uint8_t i = 0; i < NUM_CABLES; i++) {
+    winLo[i] = pgm_read_word(&ADC_LO[i]);
+    winHi[i] = pgm_read_word(&ADC_HI[i]);
+  }
+  cal.fromEeprom = false;
+}
+
+// Arranque: EEPROM si es válida, si no las de fábrica
+void calibrationLoad() {
+  CalData d;
+  EEPROM.get(CAL_EEPROM_ADDR, d);
+  bool ok = d.magic == CAL_MAGIC && d.sum == calChecksum(d);
+  for (uint8_t i = 0; ok && i < NUM_CABLES; i++)
+    ok = d.lo[i] <= d.hi[i] && d.hi[i] <= 1023;
+
+  if (!ok) {
+    calibrationDefaults();
+    return;
   }
-  return (int)(s / N_SAMPLES);
+  memcpy(winLo, d.lo, sizeof(winLo));
+  memcpy(winHi, d.hi, sizeof(winHi));
+  cal.fromEeprom = true;
+  DBG(F("📐 Ventanas de calibración cargadas de EEPROM"));
+}
+
+void calibrationSave(const uint16_t* lo, const uint16_t* hi, uint16_t magic) {
+  cal.data.magic = magic;
+  memcpy(cal.data.lo, lo, sizeof(cal.data.lo));
+  memcpy(cal.data.hi, hi, sizeof(cal.data.hi));
+  cal.data.sum = calChecksum(cal.data);
+  cal.saveIdx = 0;
+  cal.state = CAL_SAVING;
+}
+
+void calibrationStart() {
+  memset(cal.sum, 0, sizeof(cal.sum));
+  memset(cal.sumSq, 0, sizeof(cal.sumSq));
+  memset(cal.maxV, 0, sizeof(cal.maxV));
+  for (uint8_t i = 0; i < NUM_CABLES; i++) cal.minV[i] = 1023;
+  cal.rounds = 0;
+  cal.lastRound = adcRoundCount();
+  cal.state = CAL_SAMPLING;
+  gameRunning = false;
+  DBG(F("📐 Calibración iniciada"));
+}
+
+void calibrationReset() {
+  calibrationDefaults();
+  uint16_t lo[NUM_CABLES], hi[NUM_CABLES];
+  memcpy(lo, winLo, sizeof(lo));
+  memcpy(hi, winHi, sizeof(hi));
+  calibrationSave(lo, hi, 0);   // magic 0 = EEPROM sin calibración
+}
+
+uint16_t isqrt32(uint32_t v) {
+  uint16_t r = 0;
+  for (uint16_t b = 0x8000; b; b >>= 1)
+    if ((uint32_t)(r | b) * (r | b) <= v) r |= b;
+  return r;
+}
+
+void calibrationFinish() {
+  uint16_t lo[NUM_CABLES], hi[NUM_CABLES];
+  for (uint8_t i = 0; i < NUM_CABLES; i++) {
+    uint16_t mean = (cal.sum[i] + CAL_ROUNDS / 2) / CAL_ROUNDS;
+    uint32_t var = (cal.sumSq[i] - cal.sum[i] * cal.sum[i] / CAL_ROUNDS) / CAL_ROUNDS;
+    uint16_t s3 = 3 * isqrt32(var);
+
+    uint16_t defLo = pgm_read_word(&ADC_LO[i]), defHi = pgm_read_word(&ADC_HI[i]);
+    uint16_t tol = (defLo + defHi) / 2 / CAL_TOL_DIV;
+    if (mean >= ADC_OPEN || mean + tol < defLo || mean > defHi + tol) {
+      DBGF("📐 Calibración rechazada: cable %u media %u (fábrica %u..%u)", i + 1, mean, defLo, defHi);
+      cal.state = CAL_FAILED;
+      return;
+    }
+
+    uint16_t l = mean > s3 ? mean - s3 : 0;
+    uint16_t h = mean + s3;
+    if (cal.minV[i] < l) l = cal.minV[i];
+    if (cal.maxV[i] > h) h = cal.maxV[i];
+    lo[i] = l > CAL_GUARD ? l - CAL_GUARD : 0;
+    hi[i] = h + CAL_GUARD < 1023 ? h + CAL_GUARD : 1023;
+  }
+
+  memcpy(winLo, lo, sizeof(winLo));
+  memcpy(winHi, hi, sizeof(winHi));
+  cal.fromEeprom = true;
+  calibrationSave(lo, hi, CAL_MAGIC);
+  DBG(F("📐 Calibración calculada, guardando en EEPROM"));
 }
 
-float adcToOhms(int adc) {
-  if (adc <= 0) return 0.0f;
-  if (adc >= 1023) return 1e12f;
-  return RREF * (float)adc / (1023.0f - (float)adc);
+// Un paso por ejecución de la tarea de cables
+void calibrationStep() {
+  if (cal.state == CAL_SAMPLING) {
+#if ADC_NOISE_SLEEP
+    adcSleepRound();
+#endif
+    uint16_t round = adcRoundCount();
+    if (round == cal.lastRound) return;   // sin ronda nueva todavía
+    cal.lastRound = round;
+
+    for (uint8_t i = 0; i < NUM_CABLES; i++) {
+      uint16_t v = adcRead(i);
+      cal.sum[i] += v;
+      cal.sumSq[i] += (uint32_t)v * v;
+      if (v < cal.minV[i]) cal.minV[i] = v;
+      if (v > cal.maxV[i]) cal.maxV[i] = v;
+    }
+    if (++cal.rounds >= CAL_ROUNDS) calibrationFinish();
+
+  } else if (cal.state == CAL_SAVING) {
+    if (!eeprom_is_ready()) return;
+    const uint8_t* p = (const uint8_t*)&cal.data;
+    EEPROM.update(CAL_EEPROM_ADDR + cal.saveIdx, p[cal.saveIdx]);
+    if (++cal.saveIdx >= sizeof(CalData)) {
+      cal.state = CAL_DONE;
+      DBG(F("📐 Calibración guardada"));
+    }
+  }
 }
 
+bool calibrationBusy() { return cal.state == CAL_SAMPLING || cal.state == CAL_SAVING; }
+
 void gameInit() {
   completedLatch = false;
   gameRunning = true;
@@ -73,7 +428,10 @@ void gameInit() {
 void gameStart() {
   gameRunning = true;
   completedLatch = false;
-  digitalWrite(LED_GAME, LOW);
+  cableOkMask = 0;
+  cableOpenMask = 0;
+  progressReset();
+  FastPin<LED_GAME>::low();
   DBG(F("🎮 JUEGO iniciado"));
 }
 
@@ -84,8 +442,11 @@ void gameStop() {
 
 void gameRestart() {
   completedLatch = false;
+  cableOkMask = 0;
+  cableOpenMask = 0;
+  progressReset();
   gameRunning = true;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
   DBG(F("🔄 Juego reiniciado"));
 }
 
@@ -98,22 +459,32 @@ bool scanCables(bool& completedNow) {
   // Si está pausado o ya completado, no medir
   if (completedLatch || !gameRunning) return false;
 
-  // Medición de cables
-  const int total = 5;
+#if ADC_NOISE_SLEEP
+  adcSleepRound();
+#endif
+
+  // Sin ronda completa todavía no hay lecturas válidas
+  if (adcRoundCount() == 0) return false;
+
+  // Medición de cables (lo último que publicó la ISR del ADC)
   bool allConnected = true;
+  uint16_t states = 0;
   
-  for (int i = 0; i < total; i++) {
-    int adc = avgADC(APIN[i]);
-    float R = adcToOhms(adc);
-    bool ok = (R >= R_MIN[i] && R <= R_MAX[i]);
+  for (int i = 0; i < NUM_CABLES; i++) {
+    uint16_t adc = adcRead(i);
+    bool ok = cableInWindow(i, adc);
+    bool open = cableIsOpen(i, adc);
+    CableState st = ok ? CABLE_OK : open ? CABLE_OPEN : CABLE_WRONG;
+    states |= (uint16_t)st << (2 * i);
     allConnected &= ok;
   }
+  cableStates = states;
 
   if (allConnected) {
     completedNow = true;
     completedLatch = true;
     gameRunning = false;
-    digitalWrite(LED_GAME, HIGH);
+    FastPin<LED_GAME>::high();
     DBG(F("✅ JUEGO COMPLETADO - Esperando restart"));
     return true;
   }
@@ -157,10 +528,6 @@ const unsigned long RECONNECT_MS = 1000;
 unsigned long lastPingReceivedMs = 0;
 const unsigned long PING_TIMEOUT_MS = 8000;  // 8 segundos
 
-// Timing para escaneo de cables
-unsigned long lastScanMs = 0;
-const unsigned long SCAN_INTERVAL_MS = 200;  // Escanear cada 200ms
-
 // Endpoints
 const char* ARDUINO_ID = "connections";
 const char* CONNECT_PATH = "/connect";
@@ -173,6 +540,9 @@ void networkInit() {
   digitalWrite(ETH_CS, HIGH);
   
   Ethernet.init(ETH_CS);
+#if ETH_SPI_USART1
+  EthSpi.begin();
+#endif
   Ethernet.begin(mac, ipLocal, dnsServer, gateway, subnet);
   delay(400);
   
@@ -182,9 +552,9 @@ void networkInit() {
 bool isNetworkConnected() { return connectedOK; }
 
 void setStatusLeds(bool red, bool yellow, bool green) {
-  digitalWrite(LED_ROJO, red ? HIGH : LOW);
-  digitalWrite(LED_AMARILLO, yellow ? HIGH : LOW);
-  digitalWrite(LED_VERDE, green ? HIGH : LOW);
+  FastPin<LED_ROJO>::write(red);
+  FastPin<LED_AMARILLO>::write(yellow);
+  FastPin<LED_VERDE>::write(green);
 }
 
 void scheduleReconnectSoon() {
@@ -195,36 +565,29 @@ void scheduleReconnectLater() {
   nextReconnectMs = millis() + RECONNECT_MS;
 }
 
-bool postJsonTo(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(5000);
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP."));
-    return false;
-  }
+// ====== POST asíncrono por la conexión keep-alive (ver backend_client.h) ======
+// El POST se encola y networkUpdate() lo lleva por connect → envío →
+// respuesta sin esperas activas; al terminar se llama a done(ok).
+BackendClient backend(serverIp, serverPort);
 
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-
-  unsigned long t0 = millis();
-  while (!cli.available() && (millis() - t0 < 3000)) {}
-  while (cli.available()) cli.read();
-  cli.stop();
-  return true;
+// Cola de salida de /dispatch: en orden, con reintentos (ver dispatch_queue.h)
+void onDispatchDone(bool ok);
+DispatchQueue<4> outbox(backend, DISPATCH_PATH, onDispatchDone);
+void onProgressDone(uint16_t tag);
+const char PROGRESS_EVENT[] = "connections:progress";
+
+void onDispatchDone(bool ok) {
+  if (ok && outbox.headKey() == PROGRESS_EVENT) onProgressDone(outbox.headTag());
+  outbox.done(ok);
 }
 
+// false si la cola del cliente está llena; en ese caso done no se llama
+bool postJsonTo(const char* path, const String& body, void (*done)(bool) = nullptr) {
+  return backend.post(path, body, done);
+}
+
+void onConnectDone(bool ok);
+
 bool sendConnect() {
   IPAddress my = Ethernet.localIP();
   String myIp = String(my[0]) + "." + String(my[1]) + "." + String(my[2]) + "." + String(my[3]);
@@ -243,13 +606,17 @@ bool sendConnect() {
   
   DBG(F("📤 /connect:"));
   DBG(body);
-  return postJsonTo(CONNECT_PATH, body);
+  if (postJsonTo(CONNECT_PATH, body, onConnectDone)) return true;
+  onConnectDone(false);
+  return false;
 }
 
 void onServerConnected() {
   connectedOK = true;
+  progressReset();   // el servidor puede haber perdido el estado
   nextReconnectMs = 0;
   lastPingReceivedMs = millis();
+  outbox.resume();   // vaciar lo que se acumuló sin conexión
   DBG(F("✅ Conexión servidor establecida/recuperada"));
 }
 
@@ -259,6 +626,14 @@ void onServerDisconnected() {
   DBG(F("❌ Desconectado del servidor"));
 }
 
+void onConnectDone(bool ok) {
+  if (ok) {
+    onServerConnected();
+  } else {
+    nextReconnectMs = millis() + RECONNECT_MS;
+  }
+}
+
 void checkPingTimeout() {
   if (connectedOK && (millis() - lastPingReceivedMs >= PING_TIMEOUT_MS)) {
     DBG(F("⏱️ Timeout: sin PING"));
@@ -267,13 +642,9 @@ void checkPingTimeout() {
 }
 
 void handleReconnection() {
-  if (!connectedOK && (long)(millis() - nextReconnectMs) >= 0) {
+  if (!connectedOK && !backend.busy() && (long)(millis() - nextReconnectMs) >= 0) {
     DBG(F("↻ Intentando /connect..."));
-    if (sendConnect()) {
-      onServerConnected();
-    } else {
-      nextReconnectMs = millis() + RECONNECT_MS;
-    }
+    sendConnect();
   }
 }
 
@@ -305,7 +676,50 @@ bool sendDispatchCompleted() {
   
   DBG(F("📤 /dispatch (completed):"));
   DBG(body);
-  return postJsonTo(DISPATCH_PATH, body);
+  return outbox.push(body, true);
+}
+
+// ====== PROGRESO POR CABLE ======
+// connections:progress lleva solo los cables cuyo estado cambió desde el
+// último envío confirmado; el primero tras start/restart/reconexión lleva
+// los 5. Un contacto que va y vuelve entre dos envíos no genera nada.
+// Va por la cola de salida: reintentos, y uno que aún espera se sustituye
+// por el nuevo (que incluye sus cambios, ambos van contra lo confirmado)
+const char* const CABLE_STATE_NAME[] = { "open", "wrong", "ok" };
+
+// Progreso confirmado por el servidor (desde onDispatchDone)
+void onProgressDone(uint16_t tag) {
+  if ((tag >> PROGRESS_EPOCH_SHIFT) != progressEpoch) return;   // anterior a un reset
+  cableStatesSent = tag & CABLE_STATES_UNKNOWN;
+}
+
+// false si no se pudo encolar (se reintenta en la siguiente ventana)
+bool sendCableProgress(uint16_t states) {
+  String body;
+  body.reserve(200);
+  body += "{\"arduinoId\":\"";
+  body += ARDUINO_ID;
+  body += "\",\"event\":\"connections:progress\",\"data\":{\"changes\":[";
+  uint8_t correct = 0;
+  bool first = true;
+  for (uint8_t i = 0; i < NUM_CABLES; i++) {
+    CableState st = cableState(states, i);
+    if (st == CABLE_OK) correct++;
+    if (st == cableState(cableStatesSent, i)) continue;
+    if (!first) body += ",";
+    first = false;
+    body += "{\"from\":"; body += (i + 1);
+    body += ",\"state\":\""; body += CABLE_STATE_NAME[st]; body += "\"}";
+  }
+  body += "],\"correctConnections\":"; body += correct;
+  body += ",\"totalConnections\":"; body += NUM_CABLES;
+  body += "}}";
+
+  if (!outbox.push(body, false, PROGRESS_EVENT, progressTag(states))) return false;
+  cableStatesQueued = states;
+  DBG(F("📤 /dispatch (progress):"));
+  DBG(body);
+  return true;
 }
 
 String getUptimeISO8601() {
@@ -382,21 +796,113 @@ void handlePingRequest(EthernetClient& c, const String& path) {
   }
 }
 
-void handleControlPost(EthernetClient& c, int contentLength) {
-  if (contentLength <= 0 || contentLength > 512) {
-    sendHttpResponse400(c, F("Content-Length invalido"));
-    c.stop();
-    return;
+void handleStatsRequest(EthernetClient& c, const String& path) {
+  c.println(F("HTTP/1.1 200 OK"));
+  c.println(F("Content-Type: application/json; charset=utf-8"));
+  c.println(F("Connection: close"));
+  c.println();
+  c.print(F("{\"adc\":{\"rounds\":")); c.print(adcRoundCount());
+  c.print(F(",\"values\":["));
+  for (uint8_t i = 0; i < NUM_CABLES; i++) {
+    c.print(adcRead(i));
+    if (i < NUM_CABLES - 1) c.print(',');
+  }
+  c.print(F("],\"okMask\":")); c.print(cableOkMask);
+  c.print(F(",\"states\":["));
+  for (uint8_t i = 0; i < NUM_CABLES; i++) {
+    c.print('"'); c.print(CABLE_STATE_NAME[cableState(cableStates, i)]); c.print('"');
+    if (i < NUM_CABLES - 1) c.print(',');
   }
+  c.print(']');
+  c.print(F("},\"cal\":{\"state\":\"")); c.print(CAL_STATE_NAME[cal.state]);
+  c.print(F("\",\"source\":\"")); c.print(cal.fromEeprom ? F("eeprom") : F("default"));
+  c.print(F("\",\"rounds\":")); c.print(cal.rounds);
+  c.print(F(",\"lo\":["));
+  for (uint8_t i = 0; i < NUM_CABLES; i++) { c.print(winLo[i]); if (i < NUM_CABLES - 1) c.print(','); }
+  c.print(F("],\"hi\":["));
+  for (uint8_t i = 0; i < NUM_CABLES; i++) { c.print(winHi[i]); if (i < NUM_CABLES - 1) c.print(','); }
+  c.print(F("]},\"outbox\":"));
+  outbox.printJson(c);
+  c.print(F(",\"backend\":"));
+  backend.printStats(c);
+  c.print(F(",\"sched\":"));
+  sched.printStats(c);
+  c.println('}');
+  c.stop();
 
-  char body[513];
-  int n = 0;
-  unsigned long t0 = millis();
-  while (n < contentLength && (millis() - t0) < 2000) {
-    if (c.available()) body[n++] = c.read();
+  // GET /stats?reset=1 reinicia contadores y máximos
+  if (path.indexOf("reset=1") >= 0) {
+    sched.resetStats();
+    backend.resetStats();
+    outbox.resetStats();
   }
-  body[n] = 0;
-  
+}
+
+// ====== Lectura de POST /control (corrutina) ======
+// Cabeceras y body se leen con lo que haya en available() en cada pasada,
+// con un único plazo de CONTROL_REQUEST_MS para toda la petición. Mientras
+// tanto no se aceptan otras conexiones (el cliente sigue teniendo datos
+// pendientes y controlServer.available() lo volvería a devolver), así que
+// la espera acaba en cuanto el cliente cuelga.
+const unsigned long CONTROL_REQUEST_MS = 2000;
+const int CONTROL_BODY_MAX = 512;
+
+struct ControlJob {
+  Coro co;
+  EthernetClient c;
+  char line[40];        // cabecera en curso; las que no interesan se truncan
+  uint8_t lineLen;
+  bool headersDone;
+  int contentLength;
+  int n;
+  char body[CONTROL_BODY_MAX + 1];
+  bool active;
+};
+ControlJob ctrl;
+
+// Tras la línea "POST /control HTTP/1.1": el resto se lee en controlUpdate()
+void handleControlPost(EthernetClient& c) {
+  ctrl.c = c;
+  ctrl.lineLen = 0;
+  ctrl.headersDone = false;
+  ctrl.contentLength = 0;
+  ctrl.n = 0;
+  ctrl.active = true;
+  CORO_RESET(ctrl.co);
+}
+
+bool controlLengthValid() {
+  return ctrl.contentLength > 0 && ctrl.contentLength <= CONTROL_BODY_MAX;
+}
+
+// Una cabecera completa (sin CRLF); la vacía cierra las cabeceras
+void controlHeaderLine() {
+  ctrl.line[ctrl.lineLen] = '\0';
+  if (ctrl.lineLen == 0) ctrl.headersDone = true;
+  else if (strncasecmp(ctrl.line, "content-length:", 15) == 0)
+    ctrl.contentLength = atoi(ctrl.line + 15);
+  ctrl.lineLen = 0;
+}
+
+// Lee lo que haya disponible. true cuando la petición está completa, el
+// Content-Length no vale o el cliente colgó (lo distingue el llamador)
+bool controlRequestRead() {
+  while (!ctrl.headersDone && ctrl.c.available()) {
+    char ch = ctrl.c.read();
+    if (ch == '\r') continue;
+    if (ch == '\n') controlHeaderLine();
+    else if (ctrl.lineLen < sizeof(ctrl.line) - 1) ctrl.line[ctrl.lineLen++] = ch;
+  }
+  if (ctrl.headersDone) {
+    if (!controlLengthValid()) return true;
+    while (ctrl.n < ctrl.contentLength && ctrl.c.available())
+      ctrl.body[ctrl.n++] = ctrl.c.read();
+    if (ctrl.n >= ctrl.contentLength) return true;
+  }
+  return !ctrl.c.connected();
+}
+
+void handleControlBody(EthernetClient& c, const char* body) {
   String b = body;
   b.replace(" ", "");
   b.replace("\r", "");
@@ -406,17 +912,72 @@ void handleControlPost(EthernetClient& c, int contentLength) {
   DBG(b);
 
   if (b.indexOf("\"command\":\"restart\"") >= 0) {
-    gameRestart();
-    sendHttpResponse200(c, "restart");
+    if (calibrationBusy()) {
+      sendHttpResponse400(c, F("Calibrando: espera a que termine (GET /stats)"));
+    } else {
+      gameRestart();
+      sendHttpResponse200(c, "restart");
+    }
+    c.stop();
+    return;
+  }
+
+  if (b.indexOf("\"command\":\"calibrate-reset\"") >= 0 ||
+      b.indexOf("\"command\":\"calibrate\"") >= 0) {
+    bool reset = b.indexOf("calibrate-reset") >= 0;
+    if (calibrationBusy()) {
+      sendHttpResponse400(c, F("Ya hay una calibración en curso"));
+    } else {
+      if (reset) calibrationReset(); else calibrationStart();
+      sendHttpResponse200(c, reset ? "calibrate-reset" : "calibrate");
+    }
     c.stop();
     return;
   }
   
-  sendHttpResponse400(c, F("JSON no reconocido. Usa {\"command\":\"restart\"}"));
+  if (b.indexOf("\"command\":\"outbox\"") >= 0) {
+    if (outbox.loadJson(b)) sendHttpResponse200(c, "outbox");
+    else sendHttpResponse400(c, F("Cola invalida: {\"command\":\"outbox\",\"coalesceMs\":20,\"rateMs\":100,\"burst\":4}"));
+    c.stop();
+    return;
+  }
+
+  sendHttpResponse400(c, F("JSON no reconocido. Usa {\"command\":\"restart|calibrate|calibrate-reset|outbox\"}"));
   c.stop();
 }
 
+CoroStatus controlRequestStep() {
+  ControlJob& j = ctrl;
+  CORO_BEGIN(j.co);
+
+  CORO_WAIT_MS(j.co, controlRequestRead(), CONTROL_REQUEST_MS);
+
+  // Un body a medias no se ejecuta: plazo vencido o cliente desconectado
+  if (j.headersDone && !controlLengthValid()) {
+    sendHttpResponse400(j.c, F("Content-Length invalido"));
+    j.c.stop();
+    CORO_EXIT(j.co, CORO_FAILED);
+  }
+  if (!j.headersDone || j.n < j.contentLength) {
+    sendHttpResponse400(j.c, F("Peticion incompleta"));
+    j.c.stop();
+    CORO_EXIT(j.co, CORO_FAILED);
+  }
+
+  j.body[j.n] = 0;
+  handleControlBody(j.c, j.body);
+
+  CORO_END(j.co);
+}
+
+void controlUpdate() {
+  if (!ctrl.active) return;
+  if (controlRequestStep() != CORO_WAITING) ctrl.active = false;
+}
+
 void handleLocalServerRequest() {
+  if (ctrl.active) return;
+
   if (EthernetClient c = controlServer.available()) {
     c.setTimeout(100);
     String req = c.readStringUntil('\n');
@@ -437,19 +998,10 @@ void handleLocalServerRequest() {
 
     if (method == "GET" && (path.startsWith("/Ping") || path.startsWith("/ping"))) {
       handlePingRequest(c, path);
+    } else if (method == "GET" && path.startsWith("/stats")) {
+      handleStatsRequest(c, path);
     } else if (method == "POST" && path == "/control") {
-      // Leer headers para obtener Content-Length
-      int contentLength = 0;
-      while (c.connected()) {
-        String h = c.readStringUntil('\n');
-        if (h.startsWith("Content-Length:")) {
-          h.remove(0, 15);
-          h.trim();
-          contentLength = h.toInt();
-        }
-        if (h == "\r") break;
-      }
-      handleControlPost(c, contentLength);
+      handleControlPost(c);
     } else {
       sendHttpResponse400(c, F("Usa POST /control o GET /Ping?time=123"));
       c.stop();
@@ -458,7 +1010,10 @@ void handleLocalServerRequest() {
 }
 
 void networkUpdate() {
+  controlUpdate();
   handleLocalServerRequest();
+  outbox.pump(connectedOK);
+  backend.poll();
   checkPingTimeout();
   handleReconnection();
 }
@@ -475,7 +1030,8 @@ void setupHardware() {
   digitalWrite(LED_GAME, LOW);
   setStatusLeds(false, false, false);
   
-  analogReference(DEFAULT);
+  calibrationLoad();
+  adcInit();
 }
 
 void updateSystemStatus() {
@@ -489,6 +1045,64 @@ void updateSystemStatus() {
     setStatusLeds(false, true, false);    // 🟡 esperando start
 }
 
+// ====== TAREAS ======
+// net      : cada pasada, prioridad máxima
+// cables   : cada 20ms (solo compara lo que ya midió la ISR del ADC);
+//            con ADC_NOISE_SLEEP mide una ronda durmiendo cada 200ms
+// dispatch : por evento, lo levanta cables al completar
+// progress : cada 250ms como mucho un evento a la cola de salida con los
+//            cables que cambiaron
+// leds     : cada 50ms
+#if ADC_NOISE_SLEEP
+const unsigned long CABLES_PERIOD_US = 200000;
+const unsigned long CABLES_BUDGET_US = 5000;
+#else
+const unsigned long CABLES_PERIOD_US = 20000;
+const unsigned long CABLES_BUDGET_US = 1000;
+#endif
+const unsigned long PROGRESS_PERIOD_US = 250000;
+const unsigned long LEDS_PERIOD_US   = 50000;
+
+void taskNetwork() {
+  networkUpdate();
+}
+
+void taskCables() {
+  if (calibrationBusy()) {
+    calibrationStep();
+    return;
+  }
+
+  bool completedNow = false;
+  if (scanCables(completedNow) && completedNow) {
+    sched.signal(taskDispatch);
+  }
+}
+
+void taskDispatchCompleted() {
+  // A la cola de salida aunque no haya conexión: sale al reconectar
+  sendDispatchCompleted();
+}
+
+void taskProgress() {
+  // El completado va por dispatch (prioridad mayor) con el estado entero
+  if (!connectedOK || completedLatch || !gameRunning) return;
+  if (cableStates == cableStatesSent) return;   // el servidor ya lo sabe
+  // Ya va en la cola (si se descartó, se vuelve a encolar)
+  if (cableStates == cableStatesQueued && outbox.queued(PROGRESS_EVENT)) return;
+  sendCableProgress(cableStates);
+}
+
+void setupTasks() {
+  //        nombre          función                tipo             prio período           presupuesto
+  sched.add(F("net"),      taskNetwork,           TASK_EVERY_PASS, 0,   0,                 5000);
+  sched.add(F("cables"),   taskCables,            TASK_PERIODIC,   1,   CABLES_PERIOD_US,  CABLES_BUDGET_US);
+  taskDispatch =
+  sched.add(F("dispatch"), taskDispatchCompleted, TASK_EVENT,      2,   0,                 20000);
+  sched.add(F("progress"), taskProgress,          TASK_PERIODIC,   3,   PROGRESS_PERIOD_US, 5000);
+  sched.add(F("leds"),     updateSystemStatus,    TASK_PERIODIC,   4,   LEDS_PERIOD_US,    200);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(200);
@@ -500,8 +1114,11 @@ void setup() {
   Serial.print(F("IP local: "));
   Serial.println(Ethernet.localIP());
   
-  if (sendConnect()) {
-    onServerConnected();
+  // En setup sí se espera a que termine el /connect
+  sendConnect();
+  while (backend.busy()) backend.poll();
+
+  if (connectedOK) {
     DBG(F("✅ Conexión inicial exitosa"));
   } else {
     onServerDisconnected();
@@ -509,29 +1126,11 @@ void setup() {
   }
 
   updateSystemStatus();
+  setupTasks();
 }
 
 void loop() {
-  // 1. Actualizar interfaz de red (siempre máxima prioridad)
-  networkUpdate();
-
-  // 2. Actualizar LEDs de estado
-  updateSystemStatus();
-
-  // 3. Juego pausado/latcheado → nada
-  if (completedLatch || !gameRunning) return;
-
-  // 4. Medición Cables (solo cada SCAN_INTERVAL_MS)
-  if ((long)(millis() - lastScanMs) >= (long)SCAN_INTERVAL_MS) {
-    lastScanMs = millis();
-    
-    bool completedNow = false;
-    if (scanCables(completedNow)) {
-      if (completedNow && connectedOK) {
-        sendDispatchCompleted();
-      }
-    }
-  }
-  
-  // Sin delay bloqueante - el loop corre libre para responder pings rápido
-}
\ No newline at end of file
+  // Red, medición, dispatch y LEDs van como tareas con su propio ritmo.
+  // Sin delay bloqueante: el loop corre libre para responder pings rápido
+  sched.run();
+}
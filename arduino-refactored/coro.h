@@ -0,0 +1,68 @@
+// ============================================================
+// CORRUTINAS SIN PILA (estilo protothreads) para AVR
+//  - Una corrutina es una función que devuelve CoroStatus y guarda en un
+//    Coro el punto donde se quedó (número de línea, 2 bytes + marca de tiempo)
+//  - CORO_WAIT_* devuelve CORO_WAITING al llamador; la siguiente llamada
+//    retoma justo después de la espera
+//  - Las variables locales NO sobreviven a una espera: el estado que haga
+//    falta va en una struct (o static) junto al Coro
+//  - Dentro de una corrutina no se puede usar switch (las macros lo usan)
+// Uso:
+//   CoroStatus paso() {
+//     CORO_BEGIN(job.co);
+//     CORO_WAIT_MS(job.co, job.cli.available(), 800);
+//     if (!job.cli.available()) CORO_EXIT(job.co, CORO_FAILED);
+//     ...
+//     CORO_END(job.co);
+//   }
+//   // en cada pasada del loop:  if (paso() != CORO_WAITING) { ...terminado... }
+// ============================================================
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <Arduino.h>
+
+enum CoroStatus : uint8_t {
+  CORO_WAITING,   // esperando: volver a llamar en la próxima pasada
+  CORO_DONE,      // terminó bien
+  CORO_FAILED     // terminó con error
+};
+
+struct Coro {
+  uint16_t lc;          // punto de reanudación (0 = inicio)
+  unsigned long t0;     // inicio de la espera actual (CORO_WAIT_MS)
+};
+
+#define CORO_RESET(c)  do { (c).lc = 0; } while (0)
+
+#define CORO_BEGIN(c)  switch ((c).lc) { case 0:
+
+// Espera hasta que cond sea cierta
+#define CORO_WAIT_UNTIL(c, cond)                              \
+  do {                                                        \
+    (c).lc = __LINE__; case __LINE__:                         \
+    if (!(cond)) return CORO_WAITING;                         \
+  } while (0)
+
+// Espera hasta que cond sea cierta o pasen ms milisegundos. Al salir
+// hay que volver a comprobar cond para distinguir éxito de timeout.
+#define CORO_WAIT_MS(c, cond, ms)                             \
+  do {                                                        \
+    (c).t0 = millis();                                        \
+    (c).lc = __LINE__; case __LINE__:                         \
+    if (!(cond) && millis() - (c).t0 < (ms)) return CORO_WAITING; \
+  } while (0)
+
+// Cede el control una pasada
+#define CORO_YIELD(c)                                         \
+  do {                                                        \
+    (c).lc = __LINE__; return CORO_WAITING; case __LINE__:;   \
+  } while (0)
+
+// Termina antes de tiempo con el estado indicado
+#define CORO_EXIT(c, st)  do { (c).lc = 0; return (st); } while (0)
+
+#define CORO_END(c)    } (c).lc = 0; return CORO_DONE;
+
+#endif
@@ -0,0 +1,329 @@
+// ============================================================
+// COLA DE SALIDA DE /dispatch CON REINTENTOS
+//  - Los eventos se encolan siempre, haya o no conexión, y salen en orden
+//    y de uno en uno por el BackendClient (ver backend_client.h)
+//  - Si un envío falla se reintenta el mismo evento con backoff
+//    exponencial (DQ_BACKOFF_MIN_MS..DQ_BACKOFF_MAX_MS); nada pasa por
+//    delante de él. Un evento normal se abandona tras DQ_MAX_TRIES
+//    intentos (p.ej. un 400 que nunca va a cambiar); uno crítico, nunca
+//  - Sin conexión con el servidor (ping perdido, /connect pendiente) la
+//    cola solo guarda; resume() al reconectar la vacía enseguida
+//  - Llena: se descarta el evento normal más antiguo que no esté en vuelo.
+//    Los críticos (juego completado) no se descartan nunca para hacer
+//    hueco; si todo lo que hay son críticos se rechaza el nuevo
+//  - Agrupado (latest-state-wins): un evento de estado completo con el
+//    mismo nombre que otro que aún espera en la cola lo sustituye en su
+//    sitio. Además cada evento normal espera coalesceMs antes de salir,
+//    así una ráfaga de cambios en ese intervalo se queda en un solo POST
+//  - Límite de ritmo con cubeta de fichas: como mucho `burst` POST
+//    seguidos y después uno cada rateMs
+//  - Los críticos no esperan ventana ni fichas, y mientras haya uno en la
+//    cola tampoco los que tiene delante (el orden se mantiene)
+//  - Ventana y cubeta se cambian en caliente desde POST /control:
+//      {"command":"outbox","coalesceMs":20,"rateMs":100,"burst":4}
+//    (los campos que falten no cambian; rateMs 0 = sin límite)
+//  - Modo UDP opcional (useUdp, ver udp_telemetry.h): los eventos normales
+//    salen como datagrama sin confirmación y se dan por entregados; los
+//    críticos van por UDP con ACK y reenvío o, sin ACK, siguen por HTTP
+//  - Cada evento lleva un tag opcional (16 bits, lo interpreta el sketch):
+//    en onDone, headKey()/headTag() dicen qué evento acaba de terminar
+//  - N cuerpos JSON en el heap: N pequeño (4-8)
+// Uso:
+//   void onDispatchDone(bool ok);
+//   DispatchQueue<6> outbox(backend, DISPATCH_PATH, onDispatchDone);
+//   void onDispatchDone(bool ok) { outbox.done(ok); }
+//   outbox.push(body, completed, "buttons:state-changed");
+//   void networkUpdate() { outbox.pump(connectedOK); backend.poll(); ... }
+// ============================================================
+
+#ifndef DISPATCH_QUEUE_H
+#define DISPATCH_QUEUE_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "backend_client.h"
+#include "udp_telemetry.h"
+
+const unsigned long DQ_BACKOFF_MIN_MS = 250;
+const unsigned long DQ_BACKOFF_MAX_MS = 8000;
+const uint8_t DQ_MAX_TRIES = 5;
+const uint16_t DQ_COALESCE_MS = 20;   // ventana de agrupado (0 = sin ventana)
+const uint16_t DQ_RATE_MS = 100;      // una ficha cada 100 ms → 10 POST/s (0 = sin límite)
+const uint8_t DQ_BURST = 4;           // fichas máximas acumuladas
+
+template <uint8_t N>
+class DispatchQueue {
+  static_assert(N >= 2 && N <= 16, "DispatchQueue: N entre 2 y 16");
+
+public:
+  DispatchQueue(BackendClient &client, const char *path, HttpDoneFn onDone)
+    : client(client), path(path), onDone(onDone), udp(nullptr), udpAck(false),
+      head(0), count(0), criticalPending(0),
+      inFlight(false), retryAt(0), backoffMs(0),
+      coalesceMs(DQ_COALESCE_MS), rateMs(DQ_RATE_MS), burst(DQ_BURST),
+      credit((unsigned long)DQ_RATE_MS * DQ_BURST), refillMs(0),
+      maxDepth(0), sent(0), delivered(0), retries(0), dropped(0),
+      coalesced(0), throttled(0) {}
+
+  // Ventana de agrupado y cubeta de fichas (rateMs 0 = sin límite)
+  void configure(uint16_t coalesceMs_, uint16_t rateMs_, uint8_t burst_) {
+    coalesceMs = coalesceMs_;
+    rateMs = rateMs_;
+    burst = burst_ ? burst_ : 1;
+    credit = (unsigned long)rateMs * burst;
+  }
+
+  // POST /control {"command":"outbox",...} → true si se aplicó
+  bool loadJson(const String &body) {
+    long c = coalesceMs, r = rateMs, b = burst;
+    if (!parseField(body, "\"coalesceMs\"", c, 60000) ||
+        !parseField(body, "\"rateMs\"", r, 60000) ||
+        !parseField(body, "\"burst\"", b, 255)) return false;
+    configure(c, r, b);
+    return true;
+  }
+
+  // Transporte UDP para los eventos (nullptr = todo por HTTP). ackCritical:
+  // completados por UDP con ACK; si no, por HTTP
+  void useUdp(UdpTelemetry *u, bool ackCritical) {
+    udp = u;
+    udpAck = ackCritical;
+  }
+
+  // Encola un evento. Con key (nombre del evento, cadena literal) sustituye
+  // al último de ese nombre que aún no ha salido. false si no cupo (cola
+  // llena de críticos)
+  bool push(const String &body, bool critical = false, const char *key = nullptr,
+            uint16_t tag = 0) {
+    unsigned long now = millis();
+    Entry *prev = key ? findQueued(key) : nullptr;
+    if (prev) {
+      prev->body = body;
+      prev->tag = tag;
+      coalesced++;
+      if (critical) {
+        prev->critical = true;
+        criticalPending++;
+      }
+      return true;
+    }
+
+    if (count == N && !evictOldest()) {
+      dropped++;
+      return false;
+    }
+    Entry &e = q[(head + count) % N];
+    e.body = body;
+    e.key = key;
+    e.tag = tag;
+    e.critical = critical;
+    e.tries = 0;
+    e.readyAt = now + (critical ? 0 : coalesceMs);
+    count++;
+    if (count > maxDepth) maxDepth = count;
+    if (critical) criticalPending++;
+    return true;
+  }
+
+  // Cada pasada: si se puede, entrega la cabeza al cliente HTTP
+  void pump(bool online) {
+    if (inFlight || !count || !online) return;
+    unsigned long now = millis();
+    if ((long)(now - retryAt) < 0) return;
+
+    Entry &e = q[head];
+    // Con un crítico esperando, lo que tiene delante sale sin ventana ni fichas
+    bool limited = !e.critical && !criticalPending && rateMs;
+    if (!e.critical && !criticalPending) {
+      if ((long)(now - e.readyAt) < 0) return;   // ventana de agrupado abierta
+      if (limited && !takeToken(now)) return;
+    }
+
+    if (udp && !e.critical) {
+      // Datagrama sin confirmación: enviado = entregado (si se pierde, el
+      // siguiente estado lo corrige)
+      sent++;
+      if (udp->send(e.body)) delivered++;
+      else dropped++;
+      popHead();
+      return;
+    }
+
+    bool queued = (udp && udpAck) ? udp->sendReliable(e.body, onDone)
+                                  : client.post(path, e.body, onDone);
+    if (!queued) {                                 // transporte ocupado
+      if (limited) credit += rateMs;
+      return;
+    }
+    inFlight = true;
+    sent++;
+  }
+
+  // Resultado del envío de la cabeza (done del cliente HTTP o del ACK UDP)
+  void done(bool ok) {
+    inFlight = false;
+    if (ok) {
+      delivered++;
+      popHead();
+      backoffMs = 0;
+      retryAt = millis();
+    } else if (!q[head].critical && ++q[head].tries >= DQ_MAX_TRIES) {
+      dropped++;
+      popHead();
+    } else {
+      retries++;
+      backoffMs = backoffMs ? backoffMs * 2 : DQ_BACKOFF_MIN_MS;
+      if (backoffMs > DQ_BACKOFF_MAX_MS) backoffMs = DQ_BACKOFF_MAX_MS;
+      retryAt = millis() + backoffMs;
+    }
+  }
+
+  // Reconexión: vaciar ya, sin esperar al backoff pendiente
+  void resume() {
+    backoffMs = 0;
+    retryAt = millis();
+  }
+
+  uint8_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // Evento de la cabeza (el que se está enviando): válido dentro de onDone,
+  // antes de llamar a done()
+  const char *headKey() const { return count ? q[head].key : nullptr; }
+  uint16_t headTag() const { return count ? q[head].tag : 0; }
+
+  // Hay algún evento con ese nombre en la cola (en vuelo o esperando)
+  bool queued(const char *key) const {
+    for (uint8_t k = 0; k < count; k++) {
+      const Entry &e = q[(head + k) % N];
+      if (e.key && strcmp(e.key, key) == 0) return true;
+    }
+    return false;
+  }
+
+  // {"queued":..,"maxDepth":..,"sent":..,...}
+  void printJson(Print &out) const {
+    out.print(F("{\"queued\":")); out.print(count);
+    out.print(F(",\"capacity\":")); out.print(N);
+    out.print(F(",\"maxDepth\":")); out.print(maxDepth);
+    out.print(F(",\"sent\":")); out.print(sent);
+    out.print(F(",\"delivered\":")); out.print(delivered);
+    out.print(F(",\"retries\":")); out.print(retries);
+    out.print(F(",\"dropped\":")); out.print(dropped);
+    out.print(F(",\"coalesced\":")); out.print(coalesced);
+    out.print(F(",\"throttled\":")); out.print(throttled);
+    out.print(F(",\"coalesceMs\":")); out.print(coalesceMs);
+    out.print(F(",\"rateMs\":")); out.print(rateMs);
+    out.print(F(",\"burst\":")); out.print(burst);
+    out.print(F(",\"backoffMs\":")); out.print(backoffMs);
+    out.print('}');
+  }
+
+  void resetStats() {
+    maxDepth = count;
+    sent = delivered = retries = dropped = coalesced = throttled = 0;
+  }
+
+private:
+  struct Entry {
+    String body;
+    const char *key;          // nombre del evento (agrupado) o nullptr
+    uint16_t tag;             // dato del sketch (ver headTag())
+    unsigned long readyAt;    // fin de su ventana de agrupado
+    bool critical;
+    uint8_t tries;            // envíos fallidos
+  };
+
+  // El más reciente con ese nombre que sigue esperando (no en vuelo, no
+  // crítico: un completado no se reescribe)
+  Entry *findQueued(const char *key) {
+    for (uint8_t k = count; k > (inFlight ? 1 : 0); k--) {
+      Entry &e = q[(head + k - 1) % N];
+      if (e.key && !e.critical && strcmp(e.key, key) == 0) return &e;
+    }
+    return nullptr;
+  }
+
+  // "key":n con 0 <= n <= maxVal; sin la clave, value no cambia
+  static bool parseField(const String &body, const char *key, long &value, long maxVal) {
+    int i = body.indexOf(key);
+    if (i < 0) return true;
+    i = body.indexOf(':', i);
+    if (i < 0) return false;
+    String rest = body.substring(i + 1);
+    rest.trim();
+    if (!rest.length() || rest[0] < '0' || rest[0] > '9') return false;
+    long n = rest.toInt();
+    if (n > maxVal) return false;
+    value = n;
+    return true;
+  }
+
+  // Cubeta en ms de crédito: se rellena con el tiempo y cada POST cuesta rateMs
+  bool takeToken(unsigned long now) {
+    unsigned long cap = (unsigned long)rateMs * burst;
+    unsigned long add = now - refillMs;
+    credit = (add >= cap - credit) ? cap : credit + add;
+    refillMs = now;
+    if (credit < rateMs) {
+      throttled++;
+      return false;
+    }
+    credit -= rateMs;
+    return true;
+  }
+
+  void popHead() {
+    if (q[head].critical) criticalPending--;
+    q[head].body = String();
+    head = (head + 1) % N;
+    count--;
+  }
+
+  // Hace hueco quitando el normal más antiguo (la cabeza no si está en vuelo)
+  bool evictOldest() {
+    for (uint8_t k = inFlight ? 1 : 0; k < count; k++) {
+      uint8_t i = (head + k) % N;
+      if (q[i].critical) continue;
+      // Correr los posteriores un hueco hacia la cabeza
+      for (uint8_t m = k; m + 1 < count; m++) {
+        q[(head + m) % N] = q[(head + m + 1) % N];
+      }
+      q[(head + count - 1) % N].body = String();
+      count--;
+      dropped++;
+      return true;
+    }
+    return false;
+  }
+
+  BackendClient &client;
+  const char *path;
+  HttpDoneFn onDone;
+  UdpTelemetry *udp;
+  bool udpAck;
+
+  Entry q[N];
+  uint8_t head;
+  uint8_t count;
+  uint8_t criticalPending;    // críticos en la cola
+  bool inFlight;              // la cabeza está en el cliente HTTP
+  unsigned long retryAt;
+  unsigned long backoffMs;
+
+  uint16_t coalesceMs;
+  uint16_t rateMs;
+  uint8_t burst;
+  unsigned long credit;       // ms de crédito de la cubeta
+  unsigned long refillMs;     // última recarga
+
+  uint8_t maxDepth;
+  unsigned long sent;         // entregas al cliente (incluye reintentos)
+  unsigned long delivered;    // confirmados con 2xx
+  unsigned long retries;      // envíos fallidos que se repetirán
+  unsigned long dropped;      // descartados (cola llena o DQ_MAX_TRIES)
+  unsigned long coalesced;    // eventos absorbidos por uno posterior
+  unsigned long throttled;    // pasadas retenidas por falta de fichas
+};
+
+#endif
@@ -0,0 +1,87 @@
+// ============================================================
+// BUS SPI DEL ENC28J60 (opción de compilación ETH_SPI_USART1)
+//  - 0 (por defecto): SPI por hardware (D50-D53), compartido con el resto
+//    de periféricos SPI del sketch (p.ej. los 5 MFRC522 de rfid.cpp)
+//  - 1: USART1 en modo Master SPI (MSPIM), bus exclusivo para la red:
+//      MOSI = TX1 (D18), MISO = RX1 (D19), SCK = XCK1 (PD5)
+//    En el Mega 2560 PD5/XCK1 no llega a ningún header: hay que cablearlo
+//    directamente al pin del ATmega2560.
+//  - EthernetENC habla con el chip a través del objeto global SPI. Una vez
+//    parcheada (tools/patch-ethernetenc.sh, una sola vez por instalación)
+//    usa eth_spi_port.h, cuyas funciones se definen aquí: el bus lo elige
+//    ETH_SPI_USART1 del sketch
+//  - Con ETH_SPI_USART1 = 1 y la librería sin parchear el enlazado falla
+//    (falta ethSpiPortLinked) en vez de seguir en silencio en el SPI
+//    compartido
+//  - Define funciones: se incluye solo desde el .cpp del sketch
+// Uso:
+//   #define ETH_SPI_USART1 1
+//   #include "eth_spi.h"
+//   EthSpi.begin();   // antes de Ethernet.begin()
+// ============================================================
+
+#ifndef ETH_SPI_H
+#define ETH_SPI_H
+
+#include <SPI.h>
+#include "eth_spi_port.h"
+
+#ifndef ETH_SPI_USART1
+  #define ETH_SPI_USART1 0
+#endif
+
+#if ETH_SPI_USART1
+
+// Lo define la copia parcheada de EthernetENC
+extern const uint8_t ethSpiPortLinked;
+
+class UsartSpi1 {
+public:
+  void begin() {
+    // Referencia obligatoria: sin el parche no enlaza
+    (void)*(const volatile uint8_t *)&ethSpiPortLinked;
+
+    // Secuencia del datasheet (MSPIM): UBRR = 0 antes de habilitar
+    UBRR1 = 0;
+    DDRD |= _BV(5);                         // XCK1 (PD5) salida → maestro
+    UCSR1C = _BV(UMSEL11) | _BV(UMSEL10);   // MSPIM, modo 0, MSB primero
+    UCSR1B = _BV(RXEN1) | _BV(TXEN1);
+    UBRR1 = 0;                              // fXCK = F_CPU/2 = 8MHz
+  }
+
+  // Bus de un solo dispositivo: la configuración es fija
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+
+  uint8_t transfer(uint8_t data) {
+    while (!(UCSR1A & _BV(UDRE1))) {}
+    UDR1 = data;
+    while (!(UCSR1A & _BV(RXC1))) {}
+    return UDR1;
+  }
+
+  void transfer(void *buf, size_t count) {
+    uint8_t *p = (uint8_t *)buf;
+    while (count--) {
+      *p = transfer(*p);
+      p++;
+    }
+  }
+};
+
+static UsartSpi1 EthSpi;
+
+#else
+
+#define EthSpi SPI
+
+#endif
+
+// ====== Puerto de EthernetENC (eth_spi_port.h) ======
+void ethSpiBegin() { EthSpi.begin(); }
+void ethSpiBeginTransaction(SPISettings settings) { EthSpi.beginTransaction(settings); }
+void ethSpiEndTransaction() { EthSpi.endTransaction(); }
+uint8_t ethSpiTransfer(uint8_t data) { return EthSpi.transfer(data); }
+void ethSpiTransferBuf(void *buf, size_t count) { EthSpi.transfer(buf, count); }
+
+#endif
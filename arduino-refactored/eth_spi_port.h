@@ -0,0 +1,38 @@
+// ============================================================
+// PUERTO SPI DEL ENC28J60 para EthernetENC
+//  - tools/patch-ethernetenc.sh copia este header a la librería y hace que
+//    utility/Enc28J60Network.cpp use EthSpiPort en lugar del objeto SPI
+//  - Las funciones ethSpi*() las define el sketch (eth_spi.h): el bus lo
+//    elige ETH_SPI_USART1 del sketch sin volver a tocar la librería
+//  - La librería parcheada define ethSpiPortLinked; eth_spi.h lo exige
+//    con ETH_SPI_USART1 = 1 (sin parche, error de enlazado)
+// ============================================================
+
+#ifndef ETH_SPI_PORT_H
+#define ETH_SPI_PORT_H
+
+#include <SPI.h>
+
+void ethSpiBegin();
+void ethSpiBeginTransaction(SPISettings settings);
+void ethSpiEndTransaction();
+uint8_t ethSpiTransfer(uint8_t data);
+void ethSpiTransferBuf(void *buf, size_t count);
+
+// Misma interfaz que SPIClass en lo que usa la librería
+class EthSpiPort {
+public:
+  void begin() { ethSpiBegin(); }
+  void end() {}
+  void beginTransaction(SPISettings settings) { ethSpiBeginTransaction(settings); }
+  void endTransaction() { ethSpiEndTransaction(); }
+  void usingInterrupt(uint8_t) {}
+  uint8_t transfer(uint8_t data) { return ethSpiTransfer(data); }
+  void transfer(void *buf, size_t count) { ethSpiTransferBuf(buf, count); }
+  uint16_t transfer16(uint16_t data) {
+    uint8_t hi = ethSpiTransfer(data >> 8);
+    return ((uint16_t)hi << 8) | ethSpiTransfer(data & 0xFF);
+  }
+};
+
+#endif
@@ -0,0 +1,189 @@
+// ============================================================
+// GPIO RÁPIDO (Arduino Mega 2560) resuelto en compilación
+//  - FastPin<PIN>: puerto y máscara son constantes → read() es un
+//    'in'/'sbis' y high()/low() un 'sbi'/'cbi' (puertos A-G). En H-L el
+//    registro queda fuera del espacio de I/O: se hace RMW con interrupciones
+//    deshabilitadas para que sea atómico.
+//  - PinGroup<P0, P1, ...>: tabla de hasta 16 pines. read() lee una sola vez
+//    cada puerto implicado (foto coherente) y devuelve bit i = pin Pi;
+//    write(v) escribe cada puerto implicado una sola vez.
+//  - digitalRead/digitalWrite del core cuestan decenas de ciclos por la
+//    búsqueda pin → puerto en PROGMEM y la desactivación del PWM.
+// Mapa de pines sacado de pins_arduino.h (variante "mega").
+// ============================================================
+
+#ifndef FAST_GPIO_H
+#define FAST_GPIO_H
+
+#include <Arduino.h>
+
+#if defined(__AVR__) && !defined(__AVR_ATmega2560__)
+  #error "fast_gpio.h: mapa de pines solo para ATmega2560 (Arduino Mega)"
+#endif
+
+#define FASTIO_REG(addr) (*(volatile uint8_t *)(addr))
+
+enum FastPort : uint8_t { FP_A, FP_B, FP_C, FP_D, FP_E, FP_F, FP_G, FP_H, FP_J, FP_K, FP_L, FP_COUNT };
+
+// Dirección (espacio de datos) de PINx; DDRx = +1, PORTx = +2
+constexpr uint16_t FASTIO_PIN_ADDR[FP_COUNT] = {
+  0x20, 0x23, 0x26, 0x29, 0x2C, 0x2F, 0x32, 0x100, 0x103, 0x106, 0x109
+};
+
+const uint8_t FASTIO_NUM_PINS = 70;
+
+constexpr uint8_t FASTIO_PORT[FASTIO_NUM_PINS] = {
+  FP_E, FP_E, FP_E, FP_E, FP_G, FP_E, FP_H, FP_H, FP_H, FP_H,   //  0- 9
+  FP_B, FP_B, FP_B, FP_B, FP_J, FP_J, FP_H, FP_H, FP_D, FP_D,   // 10-19
+  FP_D, FP_D, FP_A, FP_A, FP_A, FP_A, FP_A, FP_A, FP_A, FP_A,   // 20-29
+  FP_C, FP_C, FP_C, FP_C, FP_C, FP_C, FP_C, FP_C, FP_D, FP_G,   // 30-39
+  FP_G, FP_G, FP_L, FP_L, FP_L, FP_L, FP_L, FP_L, FP_L, FP_L,   // 40-49
+  FP_B, FP_B, FP_B, FP_B, FP_F, FP_F, FP_F, FP_F, FP_F, FP_F,   // 50-59
+  FP_F, FP_F, FP_K, FP_K, FP_K, FP_K, FP_K, FP_K, FP_K, FP_K    // 60-69
+};
+
+constexpr uint8_t FASTIO_BIT[FASTIO_NUM_PINS] = {
+  0, 1, 4, 5, 5, 3, 3, 4, 5, 6,   //  0- 9
+  4, 5, 6, 7, 1, 0, 1, 0, 3, 2,   // 10-19
+  1, 0, 0, 1, 2, 3, 4, 5, 6, 7,   // 20-29
+  7, 6, 5, 4, 3, 2, 1, 0, 7, 2,   // 30-39
+  1, 0, 7, 6, 5, 4, 3, 2, 1, 0,   // 40-49
+  3, 2, 1, 0, 0, 1, 2, 3, 4, 5,   // 50-59
+  6, 7, 0, 1, 2, 3, 4, 5, 6, 7    // 60-69
+};
+
+// PORTA..PORTG (≤ 0x3F) admiten sbi/cbi; PORTH..PORTL no
+constexpr bool fastioBitAddressable(uint8_t port) {
+  return FASTIO_PIN_ADDR[port] + 2 < 0x40;
+}
+
+// RMW atómico de un registro (para varios bits o puertos altos)
+inline void fastioUpdate(volatile uint8_t &reg, uint8_t clear, uint8_t set) {
+  uint8_t s = SREG;
+  noInterrupts();
+  reg = (reg & ~clear) | set;
+  SREG = s;
+}
+
+// ------------------------------------------------------------
+// Pin individual
+// ------------------------------------------------------------
+template <uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < FASTIO_NUM_PINS, "FastPin: pin fuera del Mega 2560");
+
+  static constexpr uint8_t port = FASTIO_PORT[PIN];
+  static constexpr uint8_t mask = 1 << FASTIO_BIT[PIN];
+  static constexpr uint16_t addr = FASTIO_PIN_ADDR[port];
+
+  static inline bool read() { return FASTIO_REG(addr) & mask; }
+
+  static inline void high() {
+    if (fastioBitAddressable(port)) FASTIO_REG(addr + 2) |= mask;
+    else fastioUpdate(FASTIO_REG(addr + 2), 0, mask);
+  }
+
+  static inline void low() {
+    if (fastioBitAddressable(port)) FASTIO_REG(addr + 2) &= ~mask;
+    else fastioUpdate(FASTIO_REG(addr + 2), mask, 0);
+  }
+
+  static inline void write(bool v) { if (v) high(); else low(); }
+
+  // Escribir un 1 en PINx conmuta el bit de PORTx (una sola escritura)
+  static inline void toggle() { FASTIO_REG(addr) = mask; }
+
+  static inline void output() {
+    if (fastioBitAddressable(port)) FASTIO_REG(addr + 1) |= mask;
+    else fastioUpdate(FASTIO_REG(addr + 1), 0, mask);
+  }
+};
+
+// ------------------------------------------------------------
+// Tabla de pines agrupada por puerto
+// ------------------------------------------------------------
+
+// Máscara de los pines de la lista que caen en 'port'
+constexpr uint8_t fastioMask(uint8_t) { return 0; }
+
+template <typename... T>
+constexpr uint8_t fastioMask(uint8_t port, uint8_t p, T... rest) {
+  return (FASTIO_PORT[p] == port ? (1 << FASTIO_BIT[p]) : 0) | fastioMask(port, rest...);
+}
+
+// bit IDX.. del resultado ← foto del puerto de cada pin
+template <uint8_t IDX, uint8_t... P> struct FastioGather;
+
+template <uint8_t IDX> struct FastioGather<IDX> {
+  static inline uint16_t get(const uint8_t *) { return 0; }
+};
+
+template <uint8_t IDX, uint8_t P0, uint8_t... P> struct FastioGather<IDX, P0, P...> {
+  static inline uint16_t get(const uint8_t *snap) {
+    return ((snap[FASTIO_PORT[P0]] & (1 << FASTIO_BIT[P0])) ? (1u << IDX) : 0)
+         | FastioGather<IDX + 1, P...>::get(snap);
+  }
+};
+
+// bits de PORT ← bits IDX.. del valor
+template <uint8_t PORT, uint8_t IDX, uint8_t... P> struct FastioScatter;
+
+template <uint8_t PORT, uint8_t IDX> struct FastioScatter<PORT, IDX> {
+  static inline uint8_t get(uint16_t) { return 0; }
+};
+
+template <uint8_t PORT, uint8_t IDX, uint8_t P0, uint8_t... P> struct FastioScatter<PORT, IDX, P0, P...> {
+  static inline uint8_t get(uint16_t v) {
+    return ((FASTIO_PORT[P0] == PORT && (v & (1u << IDX))) ? (1 << FASTIO_BIT[P0]) : 0)
+         | FastioScatter<PORT, IDX + 1, P...>::get(v);
+  }
+};
+
+// Recorre los 11 puertos en compilación; los que no tienen pines de la
+// tabla desaparecen (mask == 0)
+template <uint8_t PORT, uint8_t... P> struct FastioPorts {
+  static constexpr uint8_t mask = fastioMask(PORT, P...);
+
+  static inline void snap(uint8_t *s) {
+    if (mask) s[PORT] = FASTIO_REG(FASTIO_PIN_ADDR[PORT]);
+    FastioPorts<PORT + 1, P...>::snap(s);
+  }
+
+  static inline void write(uint16_t v) {
+    if (mask) fastioUpdate(FASTIO_REG(FASTIO_PIN_ADDR[PORT] + 2), mask, FastioScatter<PORT, 0, P...>::get(v));
+    FastioPorts<PORT + 1, P...>::write(v);
+  }
+};
+
+template <uint8_t... P> struct FastioPorts<FP_COUNT, P...> {
+  static inline void snap(uint8_t *) {}
+  static inline void write(uint16_t) {}
+};
+
+template <uint8_t... P>
+struct PinGroup {
+  static constexpr uint8_t size = sizeof...(P);
+  static_assert(sizeof...(P) <= 16, "PinGroup: máximo 16 pines");
+
+  static constexpr uint8_t pins[sizeof...(P)] = { P... };
+
+  // bit i = nivel del pin i (1 = HIGH)
+  static inline uint16_t read() {
+    uint8_t snap[FP_COUNT];
+    FastioPorts<0, P...>::snap(snap);
+    return FastioGather<0, P...>::get(snap);
+  }
+
+  // bit i → pin i
+  static inline void write(uint16_t v) { FastioPorts<0, P...>::write(v); }
+
+  // Configuración (no es camino caliente: pinMode del core)
+  static void mode(uint8_t m) {
+    for (uint8_t i = 0; i < size; i++) pinMode(pins[i], m);
+  }
+};
+
+template <uint8_t... P>
+constexpr uint8_t PinGroup<P...>::pins[sizeof...(P)];
+
+#endif
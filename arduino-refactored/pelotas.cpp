@@ -21,6 +21,17 @@
   #define DBGF(...) do{}while(0)
 #endif
 
+// Bus del ENC28J60: 0 = SPI compartido, 1 = USART1 en modo SPI (ver eth_spi.h)
+#define ETH_SPI_USART1 0
+#include "eth_spi.h"
+
+#include "scheduler.h"
+#include "fast_gpio.h"
+#include "rules.h"
+#include "spsc_queue.h"
+#include "backend_client.h"
+#include "dispatch_queue.h"
+
 // ============================================================
 // SECCIÓN 1: CONFIGURACIÓN HARDWARE Y JUEGO
 // ============================================================
@@ -44,49 +55,71 @@ const unsigned char buttonPins[NUM_BUTTONS] = {62, 63, 64, 65, 66, 67};
 bool gameRunning = true;  // Inicia en true para pelotas
 bool completedLatch = false;
 
-// Debounce
-unsigned long lastCheck = 0;
-const unsigned long DEBOUNCE_MS = 25;
+// Los 6 botones son PK0-PK5 (PCINT16-21)
+const uint8_t BTN_MASK_ALL = 0x3F;
+
+// Combinación que completa el juego (por defecto los 6); se puede cambiar
+// con POST /control {"command":"rule",...} (ver rules.h)
+const uint8_t RULE_SLOTS = 2;
+RuleSet<RULE_SLOTS> rules(NUM_BUTTONS);
+uint8_t matchedRequired = 0;   // required de la regla cumplida
 
-// Máscara de botones previa
+// Ventana de solape: los 6 deben estar presionados a la vez al menos
+// OVERLAP_MIN_US (filtra rebotes). SYNC_MAX_SPREAD_US limita la separación
+// entre la primera y la sexta pulsación (0 = sin límite).
+const unsigned long OVERLAP_MIN_US = 25000;
+const unsigned long SYNC_MAX_SPREAD_US = 0;
+
+// Máscara de botones previa (último cambio consumido)
 uint8_t prevMask = 0;
 
-// Variable para marcar evento pendiente de dispatch
-volatile bool dispatchPending = false;
+// Instante (micros) en que se presionó cada botón y de la ventana completa
+unsigned long pressUs[NUM_BUTTONS] = {0};
+unsigned long allPressedUs = 0;
+bool allPressed = false;
+unsigned long syncSpreadUs = 0;   // separación 1ª→6ª pulsación al completar
+
+// Planificador cooperativo (tareas registradas en setup())
+Scheduler<4> sched;
+int8_t taskDispatch = -1;
+int8_t taskScan = -1;
 
 // ============================================================
 // SECCIÓN 3: LÓGICA DEL JUEGO (Funciones puras)
 // ============================================================
 
 void gameInit() {
-  prevMask = 0;
+  rules.set({ BTN_MASK_ALL, 0 });
+  // prevMask no se toca: es el estado físico (lo siembra
+  // buttonsCaptureInit() y lo sigue la ISR); a 0 un botón ya presionado
+  // daría un flanco falso y pisaría su pressUs
+  allPressed = false;
   completedLatch = false;
   gameRunning = true;
-  dispatchPending = false;
 }
 
 void gameStart() {
-  prevMask = 0;
+  allPressed = false;
   completedLatch = false;
   gameRunning = true;
-  dispatchPending = false;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
+  sched.signal(taskScan);   // re-evaluar los botones que ya estén presionados
   
   DBG(F("🎮 JUEGO iniciado - Pelotas (6 botones simultáneos)"));
 }
 
 void gameStop() {
   gameRunning = false;
-  digitalWrite(LED_GAME, completedLatch ? HIGH : LOW);
+  FastPin<LED_GAME>::write(completedLatch);
   DBG(F("⏹️ Juego detenido"));
 }
 
 void gameRestart() {
-  prevMask = 0;
+  allPressed = false;
   completedLatch = false;
   gameRunning = true;
-  dispatchPending = false;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
+  sched.signal(taskScan);
   
   DBG(F("🔄 Juego reiniciado"));
 }
@@ -97,46 +130,107 @@ bool isGameCompleted() { return completedLatch; }
 void onGameCompleted() {
   completedLatch = true;
   gameRunning = false;
-  dispatchPending = true;
-  digitalWrite(LED_GAME, HIGH);
-  DBG(F("🎉 JUEGO COMPLETADO - 6 botones presionados simultáneamente"));
+  sched.signal(taskDispatch);
+  FastPin<LED_GAME>::high();
+  DBGF("🎉 JUEGO COMPLETADO - 6 botones presionados simultáneamente (spread %luus)", syncSpreadUs);
 }
 
-bool scanButtons() {
-  // Debounce temporal
-  if (millis() - lastCheck < DEBOUNCE_MS) return false;
-  lastCheck = millis();
+// ====== DETECTOR POR PCINT2 ======
+// La ISR lee PINK de una sola vez y apunta máscara + micros() en una
+// SpscQueue, y levanta la tarea de botones (por evento): sin cambios no hay
+// coste. Si la cola se llena se sobrescribe el último evento (se pierde su
+// marca de tiempo intermedia, pero el estado final siempre llega).
+struct MaskEvent {
+  uint8_t mask;
+  unsigned long us;
+};
+
+SpscQueue<MaskEvent, 16> maskQueue;
+volatile uint8_t isrMask = 0;        // última máscara vista por la ISR
+
+ISR(PCINT2_vect) {
+  uint8_t m = ~PINK & BTN_MASK_ALL;   // PULLUP → LOW = presionado
+  if (m == isrMask) return;
+  isrMask = m;
+
+  maskQueue.pushOverwrite(MaskEvent{ m, micros() });
+  sched.signalFromIsr(taskScan);
+}
 
-  // Leer todos los botones
-  uint8_t mask = 0;
-  uint8_t pressed = 0;
-  
-  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
-    bool p = (digitalRead(buttonPins[i]) == LOW);  // PULLUP → LOW = presionado
-    if (p) {
-      mask |= (1 << i);
-      pressed++;
-    }
+void buttonsCaptureInit() {
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++)
+    *digitalPinToPCMSK(buttonPins[i]) |= bit(digitalPinToPCMSKbit(buttonPins[i]));
+  isrMask = ~PINK & BTN_MASK_ALL;
+  prevMask = isrMask;
+  PCIFR = bit(PCIE2);
+  PCICR |= bit(PCIE2);
+}
+
+// Regla nueva: re-evaluar la máscara actual como si acabara de cambiar
+void onRulesChanged() {
+  int8_t k = rules.match(prevMask);
+  allPressed = k >= 0;
+  if (allPressed) {
+    allPressedUs = micros();
+    matchedRequired = rules.get(k).required;
   }
+  sched.signal(taskScan);
+}
+
+bool scanButtons() {
+  // Consumir los cambios de máscara capturados por la ISR
+  MaskEvent ev;
+  while (maskQueue.pop(ev)) {
+    uint8_t rose = ev.mask & ~prevMask;
+    for (uint8_t i = 0; i < NUM_BUTTONS; i++)
+      if (rose & (1 << i)) pressUs[i] = ev.us;
 
-  // Log si cambió el estado
-  if (mask != prevMask) {
     #if DEBUG
-      Serial.print(F("Botones presionados: ")); Serial.print(pressed);
+      Serial.print(F("Botones presionados: ")); Serial.print(__builtin_popcount(ev.mask));
       Serial.print(F("  | Mask(b5..b0)= "));
-      for (int b = 5; b >= 0; b--) Serial.print((mask & (1 << b)) ? '1' : '0');
-      Serial.println();
+      for (int b = 5; b >= 0; b--) Serial.print((ev.mask & (1 << b)) ? '1' : '0');
+      Serial.print(F("  @")); Serial.print(ev.us); Serial.println(F("us"));
     #endif
-    prevMask = mask;
+    prevMask = ev.mask;
+
+    // La ventana de solape empieza cuando la máscara pasa a cumplir la regla
+    int8_t k = rules.match(ev.mask);
+    if (k >= 0 && !allPressed) {
+      allPressedUs = ev.us;
+      matchedRequired = rules.get(k).required;
+    }
+    allPressed = k >= 0;
   }
 
-  // Verificar si los 6 están presionados
-  if (pressed == 6) {
-    onGameCompleted();
-    return true;
+  if (!isGameRunning() || isGameCompleted() || !allPressed) return false;
+
+  // Los 6 juntos: esperar a que se cumpla la ventana de solape
+  if (micros() - allPressedUs < OVERLAP_MIN_US) {
+    sched.signal(taskScan);
+    return false;
   }
 
-  return false;
+  // Separación entre la primera y la última pulsación exigida
+  bool any = false;
+  unsigned long first = 0, last = 0;
+  for (uint8_t i = 0; i < NUM_BUTTONS; i++) {
+    if (!(matchedRequired & (1 << i))) continue;
+    unsigned long t = pressUs[i];
+    if (!any || (long)(t - first) < 0) first = t;
+    if (!any || (long)(t - last) > 0) last = t;
+    any = true;
+  }
+  unsigned long spread = last - first;
+
+  if (SYNC_MAX_SPREAD_US && spread > SYNC_MAX_SPREAD_US) {
+    DBGF("⏱️ 6 botones pero separados %luus (máx %luus)", spread, SYNC_MAX_SPREAD_US);
+    allPressed = false;   // hay que soltar y volver a intentar
+    return false;
+  }
+
+  syncSpreadUs = spread;
+  onGameCompleted();
+  return true;
 }
 
 // ============================================================
@@ -182,25 +276,53 @@ const char* ARDUINO_ID = "pelotas";
 const char* CONNECT_PATH = "/connect";
 const char* DISPATCH_PATH = "/dispatch";
 
+// Transporte de los eventos (ver udp_telemetry.h): 0 = POST /dispatch por
+// HTTP keep-alive, 1 = datagramas UDP al TELEMETRY_PORT del servidor
+#define DISPATCH_UDP 0
+// Con DISPATCH_UDP: 1 = completados por UDP con ACK, 0 = completados por HTTP
+#define DISPATCH_UDP_ACK 1
+const uint16_t TELEMETRY_PORT = 3002;
+
+// Conexión keep-alive para /dispatch (ver backend_client.h)
+BackendClient backend(serverIp, serverPort);
+
+// Cola de salida de /dispatch: en orden, con reintentos (ver dispatch_queue.h)
+void onDispatchDone(bool ok);
+DispatchQueue<4> outbox(backend, DISPATCH_PATH, onDispatchDone);
+void onDispatchDone(bool ok) { outbox.done(ok); }
+
+#if DISPATCH_UDP
+UdpTelemetry telemetry(serverIp, TELEMETRY_PORT);
+#endif
+
 void networkInit() {
   pinMode(ETH_CS, OUTPUT);
   digitalWrite(ETH_CS, HIGH);
   
   Ethernet.init(ETH_CS);
+#if ETH_SPI_USART1
+  EthSpi.begin();
+#else
   SPI.begin();
   SPI.setClockDivider(SPI_CLOCK_DIV2);
+#endif
 
   Ethernet.begin(mac, ipFallback, dnsServer, gateway, subnet);
   
   controlServer.begin();
+
+#if DISPATCH_UDP
+  telemetry.begin(TELEMETRY_PORT);
+  outbox.useUdp(&telemetry, DISPATCH_UDP_ACK);
+#endif
 }
 
 bool isNetworkConnected() { return connectedOK; }
 
 void setStatusLeds(bool red, bool yellow, bool green) {
-  digitalWrite(LED_ROJO, red ? HIGH : LOW);
-  digitalWrite(LED_AMARILLO, yellow ? HIGH : LOW);
-  digitalWrite(LED_VERDE, green ? HIGH : LOW);
+  FastPin<LED_ROJO>::write(red);
+  FastPin<LED_AMARILLO>::write(yellow);
+  FastPin<LED_VERDE>::write(green);
 }
 
 void scheduleReconnectSoon() {
@@ -215,6 +337,7 @@ void onServerConnected() {
   connectedOK = true;
   nextReconnectMs = 0;
   lastPingReceivedMs = millis();
+  outbox.resume();   // vaciar lo que se acumuló sin conexión
   DBG(F("✅ Conexión servidor establecida/recuperada"));
 }
 
@@ -224,63 +347,16 @@ void onServerDisconnected() {
   DBG(F("❌ Desconectado del servidor"));
 }
 
-bool postJsonToServer(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(50);
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP para POST"));
-    return false;
-  }
-  
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-  
-  // No esperamos respuesta, cerramos inmediatamente
-  cli.stop();
-  return true;
-}
+// ====== /connect asíncrono (ver backend_client.h) ======
+// handleReconnection() encola el /connect y el resultado llega a
+// onConnectDone() desde networkUpdate(): un servidor caído ya no congela
+// la lectura de los sensores ni la atención de /ping
+bool connectInFlight = false;
 
-bool postJsonToServerWaitResponse(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(150);
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP para POST"));
-    return false;
-  }
-  
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-
-  // Esperamos respuesta del servidor
-  unsigned long t0 = millis();
-  while (cli.connected() && millis() - t0 < 50)
-    while (cli.available()) cli.read();
-  cli.stop();
-  return true;
+void onConnectDone(bool ok) {
+  connectInFlight = false;
+  if (ok) onServerConnected();
+  else scheduleReconnectLater();
 }
 
 bool sendConnect() {
@@ -289,10 +365,9 @@ bool sendConnect() {
   String body = "{\"id\":\"" + String(ARDUINO_ID) + "\",\"ip\":\"" + myIp + "\",\"port\":" + String(ARD_PORT) + "}";
   
   DBG(F("📤 /connect:")); DBG(body);
-  bool result = postJsonToServerWaitResponse(CONNECT_PATH, body);
-  if (result) onServerConnected();
-  else onServerDisconnected();
-  return result;
+  connectInFlight = backend.post(CONNECT_PATH, body, onConnectDone);
+  if (!connectInFlight) scheduleReconnectLater();
+  return connectInFlight;
 }
 
 void checkPingTimeout() {
@@ -303,13 +378,9 @@ void checkPingTimeout() {
 }
 
 void handleReconnection() {
-  if (!connectedOK && (long)(millis() - nextReconnectMs) >= 0) {
+  if (!connectedOK && !connectInFlight && (long)(millis() - nextReconnectMs) >= 0) {
     DBG(F("↻ Intentando /connect..."));
-    if (sendConnect()) {
-      onServerConnected();
-    } else {
-      scheduleReconnectLater();
-    }
+    sendConnect();
   }
 }
 
@@ -321,11 +392,12 @@ bool sendDispatchEvent(const char* eventName, bool completed) {
   body += "\"event\":\""; body += eventName; body += "\",";
   body += "\"data\":{";
   body += "\"totalConnections\":6,";
+  if (completed) { body += "\"syncSpreadUs\":"; body += syncSpreadUs; body += ","; }
   body += "\"completed\":"; body += (completed ? "true" : "false");
   body += "}}";
 
   DBG(F("📤 /dispatch:")); DBG(body);
-  return postJsonToServer(DISPATCH_PATH, body);
+  return outbox.push(body, completed, eventName);
 }
 
 String getUptimeISO8601() {
@@ -406,6 +478,41 @@ void handlePingRequest(EthernetClient& c, const String& path) {
   }
 }
 
+void handleStatsRequest(EthernetClient& c, const String& path) {
+  c.println(F("HTTP/1.1 200 OK"));
+  c.println(F("Content-Type: application/json; charset=utf-8"));
+  c.println(F("Connection: close"));
+  c.println();
+  c.print(F("{\"buttons\":{\"mask\":")); c.print(prevMask);
+  c.print(F(",\"drops\":")); c.print(maskQueue.drops());
+  c.print(F(",\"overlapMinUs\":")); c.print(OVERLAP_MIN_US);
+  c.print(F(",\"syncSpreadUs\":")); c.print(syncSpreadUs);
+  c.print(F("},\"rules\":"));
+  rules.printJson(c);
+  c.print(F(",\"outbox\":"));
+  outbox.printJson(c);
+#if DISPATCH_UDP
+  c.print(F(",\"udp\":"));
+  telemetry.printStats(c);
+#endif
+  c.print(F(",\"backend\":"));
+  backend.printStats(c);
+  c.print(F(",\"sched\":"));
+  sched.printStats(c);
+  c.println('}');
+  c.stop();
+
+  // GET /stats?reset=1 reinicia contadores y máximos
+  if (path.indexOf("reset=1") >= 0) {
+    sched.resetStats();
+    backend.resetStats();
+    outbox.resetStats();
+#if DISPATCH_UDP
+    telemetry.resetStats();
+#endif
+  }
+}
+
 void handleControlGet(EthernetClient& c, const String& path) {
   sendHttpResponse400(c, F("Use POST /control"));
   c.stop();
@@ -438,8 +545,18 @@ void handleControlPost(EthernetClient& c) {
   } else if (body.indexOf("\"command\":\"stop\"") >= 0) {
     gameStop();
     sendHttpResponse200(c, "stop");
+  } else if (body.indexOf("\"command\":\"rule\"") >= 0) {
+    if (rules.loadJson(body)) {
+      onRulesChanged();
+      sendHttpResponse200(c, "rule");
+    } else {
+      sendHttpResponse400(c, F("Regla invalida: {\"command\":\"rule\",\"required\":[1,2,3],\"forbidden\":[4],\"slot\":0}"));
+    }
+  } else if (body.indexOf("\"command\":\"outbox\"") >= 0) {
+    if (outbox.loadJson(body)) sendHttpResponse200(c, "outbox");
+    else sendHttpResponse400(c, F("Cola invalida: {\"command\":\"outbox\",\"coalesceMs\":20,\"rateMs\":100,\"burst\":4}"));
   } else {
-    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart\"}"));
+    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart|rule|outbox\"}"));
   }
   
   c.stop();
@@ -466,6 +583,8 @@ void handleLocalServerRequest() {
 
     if (method == "GET" && (path.startsWith("/Ping") || path.startsWith("/ping"))) {
       handlePingRequest(c, path);
+    } else if (method == "GET" && path.startsWith("/stats")) {
+      handleStatsRequest(c, path);
     } else if (method == "GET" && path.startsWith("/control")) {
       handleControlGet(c, path);
     } else if (method == "POST" && path == "/control") {
@@ -478,6 +597,11 @@ void handleLocalServerRequest() {
 }
 
 void networkUpdate() {
+#if DISPATCH_UDP
+  telemetry.poll();
+#endif
+  outbox.pump(connectedOK);
+  backend.poll();
   handleLocalServerRequest();
   checkPingTimeout();
   handleReconnection();
@@ -497,6 +621,7 @@ void setupHardware() {
 
   for (int i=0; i<NUM_BUTTONS; i++) 
     pinMode(buttonPins[i], INPUT_PULLUP);
+  buttonsCaptureInit();
 }
 
 void updateSystemStatus() {
@@ -510,6 +635,39 @@ void updateSystemStatus() {
     setStatusLeds(false, true, false);    // 🟡 esperando start
 }
 
+// ====== TAREAS ======
+// net      : cada pasada, prioridad máxima
+// buttons  : por evento, la levanta la ISR de PCINT2
+// dispatch : por evento, al completar (la cola de salida reintenta)
+// leds     : cada 50ms
+const unsigned long LEDS_PERIOD_US = 50000;
+
+void taskNetwork() {
+  networkUpdate();
+}
+
+void taskButtons() {
+  // Siempre se vacía el anillo; scanButtons() solo juzga si está corriendo
+  scanButtons();
+}
+
+void taskDispatchCompleted() {
+  // A la cola de salida aunque no haya conexión: sale al reconectar
+  if (sendDispatchEvent("pelotas:state-changed", true)) {
+    DBG(F("✅ Dispatch encolado: juego completado"));
+  }
+}
+
+void setupTasks() {
+  //        nombre          función                tipo             prio período               presupuesto
+  sched.add(F("net"),      taskNetwork,           TASK_EVERY_PASS, 0,   0,                     5000);
+  taskScan =
+  sched.add(F("buttons"),  taskButtons,           TASK_EVENT,      1,   0,                     500);
+  taskDispatch =
+  sched.add(F("dispatch"), taskDispatchCompleted, TASK_EVENT,      2,   0,                     20000);
+  sched.add(F("leds"),     updateSystemStatus,    TASK_PERIODIC,   3,   LEDS_PERIOD_US,        200);
+}
+
 void setup() {
   Serial.begin(115200);
   
@@ -517,34 +675,21 @@ void setup() {
   gameInit();
   networkInit();
 
-  if (sendConnect()) {
+  // En setup sí se espera a que termine el /connect
+  sendConnect();
+  while (backend.busy()) backend.poll();
+
+  if (connectedOK) {
     DBG(F("✅ Conexión inicial exitosa"));
   } else {
     DBG(F("❌ Fallo en conexión inicial"));
   }
 
   updateSystemStatus();
+  setupTasks();
 }
 
 void loop() {
-  // 1. Actualizar interfaz de red (siempre máxima prioridad)
-  networkUpdate();
-
-  // 2. Envíos pendientes: /dispatch si quedó marcado
-  if (isNetworkConnected() && dispatchPending) {
-    if (sendDispatchEvent("pelotas:state-changed", true)) {
-      dispatchPending = false;
-      DBG(F("✅ Dispatch enviado: juego completado"));
-    } else {
-      onServerDisconnected();
-    }
-  }
-
-  // 3. Lógica del juego (solo si está corriendo y no completado)
-  if (isGameRunning() && !isGameCompleted()) {
-    scanButtons();
-  }
-
-  // 4. Actualizar LEDs de estado
-  updateSystemStatus();
-}
\ No newline at end of file
+  // Red, escaneo, dispatch y LEDs van como tareas con su propio ritmo
+  sched.run();
+}
@@ -22,14 +22,58 @@
   #define DBGF(...) do{}while(0)
 #endif
 
+// Bus del ENC28J60: 0 = SPI compartido, 1 = USART1 en modo SPI (ver eth_spi.h)
+#define ETH_SPI_USART1 0
+#include "eth_spi.h"
+
+#include "scheduler.h"
+#include "fast_gpio.h"
+#include "backend_client.h"
+#include "dispatch_queue.h"
+#include "rfid_scan.h"
+
 // ============================================================
 // SECCIÓN 1: CONFIGURACIÓN HARDWARE Y JUEGO
 // ============================================================
 
 // RFID Readers (5 lectores)
 const int NUM_READERS = 5;
-const uint8_t CS_PINS[NUM_READERS]  = { 19, 20, 21, 24, 22 };
-const uint8_t RST_PINS[NUM_READERS] = { 14, 15, 16, 17, 18 };
+#if ETH_SPI_USART1
+  // D18/D19 pasan a ser MOSI/MISO del bus de red: lector 1 CS → D23,
+  // lector 5 RST → D25
+  #define RFID_CS_LIST 23, 20, 21, 24, 22
+  const uint8_t RST_PINS[NUM_READERS] = { 14, 15, 16, 17, 25 };
+#else
+  #define RFID_CS_LIST 19, 20, 21, 24, 22
+  const uint8_t RST_PINS[NUM_READERS] = { 14, 15, 16, 17, 18 };
+#endif
+const uint8_t CS_PINS[NUM_READERS] = { RFID_CS_LIST };
+
+// CS de los 5 lectores como grupo: seleccionar uno = una escritura por puerto
+typedef PinGroup<RFID_CS_LIST> RfidCsPins;
+const uint16_t RFID_CS_IDLE = (1u << NUM_READERS) - 1;   // todos en HIGH
+
+// Sondeo en pipeline: lanza REQA en los 5 lectores a la vez y recoge las
+// respuestas después, así los 5 timeouts se solapan (1 = pipeline,
+// 0 = sondeo secuencial con PICC_IsNewCardPresent()).
+#define RFID_PIPELINED_POLL 1
+
+// Perfil de timer "fast presence" solo para el sondeo REQA (1 = activo).
+// Anticolisión/select siempre vuelven al perfil conservador de PCD_Init().
+#define RFID_FAST_PRESENCE 1
+
+// Detección por pin IRQ (opcional, requiere cablear la salida IRQ de cada
+// MFRC522). Los lectores reciben un REQA de "card detect" cada
+// RFID_IRQ_DETECT_PERIOD_US (rfid_scan.h) y solo se lee el UID de los que levantan IRQ;
+// sin movimiento de tarjetas el bus SPI queda libre entre ciclos.
+// IRQ lector 1..5 → A8..A12 (PK0..PK4, PCINT2): bit i de PINK = lector i.
+#define RFID_USE_IRQ 0
+const uint8_t IRQ_PINS[NUM_READERS] = { 62, 63, 64, 65, 66 };
+const unsigned long RFID_IRQ_MARGIN_US = 500;
+
+#if RFID_USE_IRQ && !RFID_PIPELINED_POLL
+  #error "RFID_USE_IRQ requiere RFID_PIPELINED_POLL"
+#endif
 
 // LEDs de estado
 #define LED_ROJO     5
@@ -48,11 +92,31 @@ MFRC522* rc[NUM_READERS];
 bool gameRunning = false;
 bool completedLatch = false;
 
+// Planificador cooperativo (tareas registradas en setup())
+Scheduler<4> sched;
+int8_t taskDispatch = -1;
+bool dispatchCompleted = false;   // el próximo dispatch lleva completed=true
+
 // Estado de tarjetas RFID
 String lastUID[NUM_READERS] = {"","","","",""};
 unsigned long lastTime[NUM_READERS] = {0,0,0,0,0};
 const unsigned long REPEAT_TIMEOUT = 800;
 
+// Presencia por lector: tras leer un UID la tarjeta queda en HALT y se
+// confirma cada RFID_PRESENCE_PERIOD_MS con WUPA (+ HLTA para devolverla a
+// HALT), sin anticolisión/select. Tras RFID_PRESENCE_MISSES sondeos sin
+// respuesta se da por retirada: el retiro se reporta en ~PERIOD*MISSES.
+enum RfidPresence : uint8_t {
+  RFID_CARD_NONE,      // sin UID
+  RFID_CARD_PRESENT,   // UID leído, última sonda respondió
+  RFID_CARD_MISSING    // UID leído, falló al menos una sonda
+};
+RfidPresence rfidPresence[NUM_READERS] = { RFID_CARD_NONE };
+uint8_t rfidMisses[NUM_READERS] = {0};
+unsigned long rfidPresenceMs[NUM_READERS] = {0};
+const unsigned long RFID_PRESENCE_PERIOD_MS = 150;
+const uint8_t RFID_PRESENCE_MISSES = 2;
+
 // ============================================================
 // SECCIÓN 3: LÓGICA DEL JUEGO (Funciones puras)
 // ============================================================
@@ -81,11 +145,419 @@ bool verificarCompletado() {
   return true;
 }
 
+// ====== BUS SPI COMPARTIDO (ENC28J60 + 5× MFRC522) ======
+// Todos los chips comparten el SPI por hardware. Cada acceso se hace dentro
+// de una transacción (SPI.beginTransaction) con la configuración del chip y
+// se contabiliza cuánto tiempo ocupa el bus cada dispositivo (GET /stats).
+// Reloj máximo seguro: ENC28J60 admite 20MHz (y la errata pide >= 8MHz),
+// MFRC522 admite 10MHz; el Mega a 16MHz llega como máximo a F_CPU/2 = 8MHz.
+// Las librerías abren además sus propias transacciones internas; los
+// accesos directos a registros del motor RFID (más abajo) usan estas.
+enum SpiDevice : uint8_t {
+  SPI_DEV_ETH = 0,
+  SPI_DEV_RFID0           // SPI_DEV_RFID0 + i = lector i
+};
+const uint8_t SPI_NUM_DEVICES = 1 + NUM_READERS;
+
+const SPISettings SPI_ETH_SETTINGS(8000000, MSBFIRST, SPI_MODE0);
+const SPISettings SPI_RFID_SETTINGS(8000000, MSBFIRST, SPI_MODE0);
+
+struct SpiBusStats {
+  unsigned long busyMs;
+  unsigned long busyRemUs;
+  unsigned long grants;
+  unsigned long maxHoldUs;
+};
+SpiBusStats spiStats[SPI_NUM_DEVICES];
+uint8_t spiOwner = SPI_NUM_DEVICES;   // nadie
+unsigned long spiGrantUs = 0;
+
+// Entre transacciones de lectores se atiende la red si lleva más de este
+// tiempo sin servicio: la espera de un paquete entrante queda acotada.
+const unsigned long SPI_NET_INTERLEAVE_US = 2000;
+unsigned long spiNetServiceUs = 0;
+unsigned long spiNetInterleaves = 0;
+
+// Benchmark bus compartido vs. bus USART: hueco entre servicios de red
+// consecutivos = lo máximo que un /ping puede esperar a ser atendido.
+unsigned long netGapLastUs = 0;
+unsigned long netGapMaxUs = 0;
+unsigned long netGapAvgUs = 0;     // media móvil (1/16)
+
+void spiBusAcquire(uint8_t dev) {
+#if ETH_SPI_USART1
+  // La red va por su propio bus: aquí solo se contabiliza su tiempo
+  if (dev != SPI_DEV_ETH) SPI.beginTransaction(SPI_RFID_SETTINGS);
+#else
+  SPI.beginTransaction(dev == SPI_DEV_ETH ? SPI_ETH_SETTINGS : SPI_RFID_SETTINGS);
+#endif
+  spiOwner = dev;
+  spiGrantUs = micros();
+}
+
+void spiBusRelease() {
+  unsigned long held = micros() - spiGrantUs;
+  SpiBusStats &st = spiStats[spiOwner];
+  st.busyRemUs += held;
+  st.busyMs += st.busyRemUs / 1000;
+  st.busyRemUs %= 1000;
+  st.grants++;
+  if (held > st.maxHoldUs) st.maxHoldUs = held;
+#if ETH_SPI_USART1
+  if (spiOwner != SPI_DEV_ETH) SPI.endTransaction();
+#else
+  SPI.endTransaction();
+#endif
+  spiOwner = SPI_NUM_DEVICES;
+}
+
+// Definida en la SECCIÓN 4 (interfaz de red)
+void handleLocalServerRequest();
+
+// Punto de intercalado entre transacciones de lectores (bus libre)
+void spiBusInterleave() {
+  if (micros() - spiNetServiceUs < SPI_NET_INTERLEAVE_US) return;
+  spiNetInterleaves++;
+  spiBusAcquire(SPI_DEV_ETH);
+  handleLocalServerRequest();
+  spiBusRelease();
+  spiNetServiceUs = micros();
+}
+
+// Acceso directo a registros del MFRC522 (dentro de spiBusAcquire del
+// lector). Los valores de MFRC522::PCD_Register ya vienen desplazados.
+inline void rfidSelect(uint8_t i) { RfidCsPins::write(RFID_CS_IDLE & ~(1u << i)); }
+inline void rfidDeselect()        { RfidCsPins::write(RFID_CS_IDLE); }
+
+void rfidWriteReg(uint8_t i, byte reg, byte val) {
+  rfidSelect(i);
+  SPI.transfer(reg);
+  SPI.transfer(val);
+  rfidDeselect();
+}
+
+void rfidWriteRegs(uint8_t i, byte reg, byte count, const byte *vals) {
+  rfidSelect(i);
+  SPI.transfer(reg);
+  for (byte k = 0; k < count; k++) SPI.transfer(vals[k]);
+  rfidDeselect();
+}
+
+byte rfidReadReg(uint8_t i, byte reg) {
+  rfidSelect(i);
+  SPI.transfer(0x80 | reg);
+  byte val = SPI.transfer(0);
+  rfidDeselect();
+  return val;
+}
+
+// ====== MOTOR DE ESCANEO RFID (no bloqueante) ======
+// La máquina de estados está en rfid_scan.h; aquí van las operaciones de
+// lector que usa (RfidIo, más abajo) sobre el MFRC522 y el SPI compartido.
+
+// Pipeline: bits por lector (bit i = lector i)
+const uint8_t RFID_ALL_READERS = (1 << NUM_READERS) - 1;
+
+// Flags levantados por la ISR de PCINT2 (bit i = IRQ del lector i)
+volatile uint8_t rfidIrqFlags = 0;
+
+#if RFID_USE_IRQ
+ISR(PCINT2_vect) {
+  // IRQ activo en bajo (IRqInv = 1 en ComIEnReg)
+  rfidIrqFlags |= (uint8_t)~PINK & RFID_ALL_READERS;
+}
+#endif
+
+// Lanza REQA/WUPA sin esperar la respuesta. Replica los pasos de
+// PICC_IsNewCardPresent() + PCD_CommunicateWithPICC() hasta StartSend; el
+// timer del lector (TAuto) arranca solo al terminar la transmisión.
+void rfidStartRequest(uint8_t i, byte cmd) {
+  spiBusAcquire(SPI_DEV_RFID0 + i);
+  rfidWriteReg(i, MFRC522::TxModeReg, 0x00);
+  rfidWriteReg(i, MFRC522::RxModeReg, 0x00);
+  rfidWriteReg(i, MFRC522::ModWidthReg, 0x26);
+  rfidWriteReg(i, MFRC522::CollReg, rfidReadReg(i, MFRC522::CollReg) & ~0x80);
+  rfidWriteReg(i, MFRC522::CommandReg, MFRC522::PCD_Idle);
+  rfidWriteReg(i, MFRC522::ComIrqReg, 0x7F);           // limpiar IRQs
+  rfidWriteReg(i, MFRC522::FIFOLevelReg, 0x80);        // vaciar FIFO
+  rfidWriteReg(i, MFRC522::FIFODataReg, cmd);
+  rfidWriteReg(i, MFRC522::BitFramingReg, 0x07);       // trama corta: 7 bits
+  rfidWriteReg(i, MFRC522::CommandReg, MFRC522::PCD_Transceive);
+  rfidWriteReg(i, MFRC522::BitFramingReg, 0x87);       // StartSend
+  spiBusRelease();
+}
+
+// Consulta el resultado de rfidStartRequest() sin bloquear.
+// 1 = tarjeta presente, 0 = sin tarjeta (timeout/error), -1 = esperando.
+int8_t rfidPollRequest(uint8_t i) {
+  int8_t res = -1;
+  spiBusAcquire(SPI_DEV_RFID0 + i);
+  byte irq = rfidReadReg(i, MFRC522::ComIrqReg);
+  if (irq & 0x30) {                                    // RxIRq | IdleIRq
+    byte err = rfidReadReg(i, MFRC522::ErrorReg);
+    if (err & 0x13) res = 0;                           // BufferOvfl, Parity, Protocol
+    else if (err & 0x08) res = 1;                      // CollErr: hay tarjeta(s)
+    else if (rfidReadReg(i, MFRC522::FIFOLevelReg) != 2) res = 0;  // ATQA: 2 bytes
+    else res = (rfidReadReg(i, MFRC522::ControlReg) & 0x07) == 0 ? 1 : 0;
+  } else if (irq & 0x01) {                             // TimerIRq
+    res = 0;
+  }
+  spiBusRelease();
+  return res;
+}
+
+// ====== PERFILES DE TIMER DEL MFRC522 ======
+// El timeout de cada transceive lo marca el timer interno del lector:
+// t = (2*TPrescaler+1) * (TReload+1) / 13.56MHz. Con TPrescaler = 0xA9 cada
+// tick dura 25µs; PCD_Init() carga TReload = 0x3E8 → ~25ms por lector vacío.
+// La ATQA de una tarjeta llega ~100µs después del REQA, así que para el
+// sondeo de presencia 1ms sobra. La ganancia de antena (RFCfgReg) es la
+// de PCD_Init() en los dos perfiles.
+struct RfidTimerProfile {
+  byte tPrescaler;
+  uint16_t tReload;
+};
+
+const unsigned long RFID_TIMER_TICK_US = 25;
+const unsigned long RFID_CONSERVATIVE_TIMEOUT_US = 25025;
+const unsigned long RFID_FAST_TIMEOUT_US = 1000;
+
+const RfidTimerProfile RFID_PROFILE_CONSERVATIVE = {
+  0xA9, RFID_CONSERVATIVE_TIMEOUT_US / RFID_TIMER_TICK_US - 1
+};
+const RfidTimerProfile RFID_PROFILE_FAST = {
+  0xA9, RFID_FAST_TIMEOUT_US / RFID_TIMER_TICK_US - 1
+};
+
+uint8_t rfidFastMask = 0;     // bit i: el lector i tiene cargado el perfil rápido
+bool rfidFastEnabled = RFID_FAST_PRESENCE;
+
+// Vuelta al perfil conservador: el motor audita de vez en cuando con el
+// timer conservador un lector que dio vacío con el rápido (rfid_scan.h).
+// Si en RFID_AUDIT_WINDOW auditorías el conservador ve tarjeta en
+// RFID_AUDIT_MAX_MISSES o más, el perfil rápido está perdiendo tarjetas.
+// Las lecturas de UID no sirven para esto: siempre van con el conservador.
+const uint8_t RFID_AUDIT_WINDOW = 8;
+const uint8_t RFID_AUDIT_MAX_MISSES = 2;
+uint8_t rfidAuditWindow = 0;
+uint8_t rfidAuditWindowMisses = 0;
+
+// Estadísticas (GET /stats)
+unsigned long rfidReadOk = 0;
+unsigned long rfidReadFail = 0;
+long rfidFastSavedMs = 0;    // ahorro neto frente al perfil conservador (menos auditorías)
+long rfidFastSavedRemUs = 0;
+
+void rfidApplyProfile(uint8_t i, bool fast) {
+  if (((rfidFastMask >> i) & 1) == (fast ? 1 : 0)) return;
+  const RfidTimerProfile &p = fast ? RFID_PROFILE_FAST : RFID_PROFILE_CONSERVATIVE;
+  spiBusAcquire(SPI_DEV_RFID0 + i);
+  rfidWriteReg(i, MFRC522::TPrescalerReg, p.tPrescaler);
+  rfidWriteReg(i, MFRC522::TReloadRegH, p.tReload >> 8);
+  rfidWriteReg(i, MFRC522::TReloadRegL, p.tReload & 0xFF);
+  spiBusRelease();
+  if (fast) rfidFastMask |= (1 << i);
+  else rfidFastMask &= ~(1 << i);
+}
+
+void rfidNoteSaving(long us) {
+  rfidFastSavedRemUs += us;
+  rfidFastSavedMs += rfidFastSavedRemUs / 1000;
+  rfidFastSavedRemUs %= 1000;
+}
+
+// Un sondeo terminó por timeout con el perfil rápido: acumular el ahorro
+void rfidNoteFastTimeout() {
+  rfidNoteSaving(RFID_CONSERVATIVE_TIMEOUT_US - RFID_FAST_TIMEOUT_US);
+}
+
+void rfidNoteRead(bool ok) {
+  if (ok) rfidReadOk++;
+  else rfidReadFail++;
+}
+
+// Resultado de una auditoría (missed: el conservador vio una tarjeta que
+// el rápido dio por ausente). Una auditoría vacía cuesta un timeout entero.
+void rfidAuditResult(bool missed) {
+  if (!missed) rfidNoteSaving(-(long)RFID_CONSERVATIVE_TIMEOUT_US);
+  if (!rfidFastEnabled) return;
+
+  if (missed) rfidAuditWindowMisses++;
+  if (++rfidAuditWindow < RFID_AUDIT_WINDOW) return;
+
+  if (rfidAuditWindowMisses >= RFID_AUDIT_MAX_MISSES) {
+    rfidFastEnabled = false;
+    DBG(F("⚠️ RFID: el perfil rápido pierde tarjetas → perfil conservador"));
+  }
+  rfidAuditWindow = 0;
+  rfidAuditWindowMisses = 0;
+}
+
+// Ventana de recogida en modo IRQ: timeout del perfil activo + margen.
+// Pasada la ventana, los lectores que no levantaron IRQ están vacíos.
+unsigned long rfidIrqWindowUs() {
+  return (rfidFastEnabled ? RFID_FAST_TIMEOUT_US : RFID_CONSERVATIVE_TIMEOUT_US)
+         + RFID_IRQ_MARGIN_US;
+}
+
+// ====== SONDAS DE PRESENCIA (WUPA/HLTA) ======
+bool rfidPresenceDue(uint8_t i) {
+  return rfidPresence[i] != RFID_CARD_NONE &&
+         (millis() - rfidPresenceMs[i] >= RFID_PRESENCE_PERIOD_MS);
+}
+
+// Resultado de una sonda WUPA. Devuelve true si la tarjeta se dio por
+// retirada (cambio de estado a reportar).
+bool rfidPresenceResult(uint8_t i, bool present) {
+  rfidPresenceMs[i] = millis();
+  if (present) {
+    rfidPresence[i] = RFID_CARD_PRESENT;
+    rfidMisses[i] = 0;
+    return false;
+  }
+
+  rfidPresence[i] = RFID_CARD_MISSING;
+  if (++rfidMisses[i] < RFID_PRESENCE_MISSES) return false;
+
+  #if DEBUG
+    Serial.print(F("📤 Lector ")); Serial.print(i+1);
+    Serial.print(F(" → retirada ")); Serial.println(lastUID[i]);
+  #endif
+
+  lastUID[i] = "";
+  lastTime[i] = 0;
+  rfidPresence[i] = RFID_CARD_NONE;
+  rfidMisses[i] = 0;
+  return true;
+}
+
+// Sonda bloqueante (modo secuencial): WUPA despierta la tarjeta desde HALT
+// y HLTA la devuelve a HALT para que el REQA del barrido no la relea.
+bool rfidWakeupProbe(MFRC522 &r) {
+  byte atqa[2];
+  byte size = sizeof(atqa);
+  MFRC522::StatusCode st = r.PICC_WakeupA(atqa, &size);
+  bool present = (st == MFRC522::STATUS_OK || st == MFRC522::STATUS_COLLISION);
+  if (present) r.PICC_HaltA();
+  return present;
+}
+
+// HLTA sin esperar (modo pipeline): comando Transmit con el CRC_A ya
+// calculado, la tarjeta no responde a HLTA. El motor espera
+// RFID_HLTA_GUARD_US antes del siguiente ARM.
+
+void rfidStartHalt(uint8_t i) {
+  const byte hlta[4] = { MFRC522::PICC_CMD_HLTA, 0x00, 0x57, 0xCD };
+  spiBusAcquire(SPI_DEV_RFID0 + i);
+  rfidWriteReg(i, MFRC522::CommandReg, MFRC522::PCD_Idle);
+  rfidWriteReg(i, MFRC522::ComIrqReg, 0x7F);
+  rfidWriteReg(i, MFRC522::FIFOLevelReg, 0x80);
+  rfidWriteRegs(i, MFRC522::FIFODataReg, sizeof(hlta), hlta);
+  rfidWriteReg(i, MFRC522::BitFramingReg, 0x00);
+  rfidWriteReg(i, MFRC522::CommandReg, MFRC522::PCD_Transmit);
+  spiBusRelease();
+}
+
+// Registra el UID leído en el lector i. Devuelve true si hubo cambio.
+bool rfidStoreUid(uint8_t i) {
+  MFRC522 &r = *rc[i];
+  String uid = uidToHex(r.uid);
+  unsigned long now = millis();
+
+  rfidPresence[i] = RFID_CARD_PRESENT;
+  rfidMisses[i] = 0;
+  rfidPresenceMs[i] = now;
+
+  // Evitar lecturas repetidas
+  if (uid == lastUID[i] && (now - lastTime[i] < REPEAT_TIMEOUT)) {
+    r.PICC_HaltA();
+    return false;
+  }
+
+  lastUID[i] = uid;
+  lastTime[i] = now;
+
+  #if DEBUG
+    Serial.print(F("🏷️ Lector ")); Serial.print(i+1);
+    Serial.print(F(" → ")); Serial.println(uid);
+  #endif
+
+  r.PICC_HaltA();
+  r.PCD_StopCrypto1();  // Liberar recursos para siguiente lectura
+  return true;
+}
+
+// Operaciones de lector para el motor (ver rfid_scan.h)
+struct RfidIo {
+  static unsigned long now() { return micros(); }
+  static bool fastEnabled() { return rfidFastEnabled; }
+  static void applyProfile(uint8_t i, bool fast) { rfidApplyProfile(i, fast); }
+  static void noteFastTimeout() { rfidNoteFastTimeout(); }
+  static void auditResult(uint8_t, bool missed) { rfidAuditResult(missed); }
+  static bool presenceDue(uint8_t i) { return rfidPresenceDue(i); }
+  static bool presenceResult(uint8_t i, bool present) { return rfidPresenceResult(i, present); }
+
+  static bool wakeupProbe(uint8_t i) {
+    spiBusAcquire(SPI_DEV_RFID0 + i);
+    bool present = rfidWakeupProbe(*rc[i]);
+    spiBusRelease();
+    return present;
+  }
+
+  static bool probe(uint8_t i) {
+    spiBusAcquire(SPI_DEV_RFID0 + i);
+    bool present = rc[i]->PICC_IsNewCardPresent();
+    spiBusRelease();
+    return present;
+  }
+
+  static bool read(uint8_t i) {
+    spiBusAcquire(SPI_DEV_RFID0 + i);
+    bool ok = rc[i]->PICC_ReadCardSerial();
+    rfidNoteRead(ok);
+    bool changed = ok && rfidStoreUid(i);
+    spiBusRelease();
+    return changed;
+  }
+
+  static void startRequest(uint8_t i, bool wupa) {
+    rfidStartRequest(i, wupa ? MFRC522::PICC_CMD_WUPA : MFRC522::PICC_CMD_REQA);
+  }
+  static int8_t pollRequest(uint8_t i) { return rfidPollRequest(i); }
+  static void startHalt(uint8_t i) { rfidStartHalt(i); }
+  static void interleave() { spiBusInterleave(); }
+
+  static uint8_t irqFlags() { return rfidIrqFlags; }
+  static void clearIrqFlags() { rfidIrqFlags = 0; }
+  static unsigned long irqWindowUs() { return rfidIrqWindowUs(); }
+};
+
+RfidScanEngine<RfidIo, NUM_READERS, RFID_PIPELINED_POLL, RFID_USE_IRQ> rfidScan;
+
+// Ejecuta como mucho una operación de lector. passStartUs = micros() al
+// inicio de la pasada del loop(), para respetar RFID_PASS_BUDGET_US.
+bool scanRFIDStep(unsigned long passStartUs, bool& completedNow) {
+  completedNow = false;
+  if (!rfidScan.step(passStartUs)) return false;
+
+  // Verificar completitud (solo puede cambiar cuando cambia un UID)
+  completedNow = verificarCompletado();
+  if (completedNow) {
+    FastPin<LED_GAME>::high();
+    DBG(F("✅ RFID COMPLETADO - Esperando restart"));
+  }
+
+  return true;
+}
+
 void resetRonda() {
   for (int i = 0; i < NUM_READERS; i++) {
     lastUID[i] = "";
     lastTime[i] = 0;
+    rfidPresence[i] = RFID_CARD_NONE;
+    rfidMisses[i] = 0;
   }
+  rfidScan.reset();
   Serial.println(F("{\"info\":\"reset\",\"msg\":\"Listo para nueva ronda\"}"));
 }
 
@@ -99,13 +571,13 @@ void gameStart() {
   resetRonda();
   completedLatch = false;
   gameRunning = true;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
   DBG(F("🎮 JUEGO iniciado"));
 }
 
 void gameStop() {
   gameRunning = false;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
   DBG(F("⏹️ Juego detenido"));
 }
 
@@ -113,55 +585,12 @@ void gameRestart() {
   resetRonda();
   completedLatch = false;
   gameRunning = true;
-  digitalWrite(LED_GAME, LOW);
+  FastPin<LED_GAME>::low();
   DBG(F("🔄 Juego reiniciado"));
 }
 
 bool isGameRunning() { return gameRunning; }
 
-bool scanRFID(bool& completedNow) {
-  bool anyChange = false;
-  completedNow = false;
-  
-  for (int i = 0; i < NUM_READERS; i++) {
-    MFRC522 &r = *rc[i];
-    
-    // Verificación rápida sin bloqueo
-    if (!r.PICC_IsNewCardPresent()) continue;
-    if (!r.PICC_ReadCardSerial()) continue;
-    
-    String uid = uidToHex(r.uid);
-    unsigned long now = millis();
-    
-    // Evitar lecturas repetidas
-    if (uid == lastUID[i] && (now - lastTime[i] < REPEAT_TIMEOUT)) {
-      r.PICC_HaltA();
-      continue;
-    }
-    
-    lastUID[i] = uid;
-    lastTime[i] = now;
-    anyChange = true;
-    
-    #if DEBUG
-      Serial.print(F("🏷️ Lector ")); Serial.print(i+1);
-      Serial.print(F(" → ")); Serial.println(uid);
-    #endif
-    
-    r.PICC_HaltA();
-    r.PCD_StopCrypto1();  // Liberar recursos para siguiente lectura
-  }
-  
-  // Verificar completitud
-  completedNow = verificarCompletado();
-  if (completedNow) {
-    digitalWrite(LED_GAME, HIGH);
-    DBG(F("✅ RFID COMPLETADO - Esperando restart"));
-  }
-  
-  return anyChange || completedNow;
-}
-
 // ============================================================
 // SECCIÓN 4: INTERFAZ DE RED (Variables y funciones)
 // ============================================================
@@ -208,8 +637,24 @@ const char* ARDUINO_ID = "rfid";
 const char* CONNECT_PATH = "/connect";
 const char* DISPATCH_PATH = "/dispatch";
 
-// Keep-alive connection
-EthernetClient backendConn;
+// Transporte de los eventos (ver udp_telemetry.h): 0 = POST /dispatch por
+// HTTP keep-alive, 1 = datagramas UDP al TELEMETRY_PORT del servidor
+#define DISPATCH_UDP 0
+// Con DISPATCH_UDP: 1 = completados por UDP con ACK, 0 = completados por HTTP
+#define DISPATCH_UDP_ACK 1
+const uint16_t TELEMETRY_PORT = 3002;
+
+// Conexión keep-alive para /dispatch (ver backend_client.h)
+BackendClient backend(serverIp, serverPort);
+
+// Cola de salida de /dispatch: en orden, con reintentos (ver dispatch_queue.h)
+void onDispatchDone(bool ok);
+DispatchQueue<4> outbox(backend, DISPATCH_PATH, onDispatchDone);
+void onDispatchDone(bool ok) { outbox.done(ok); }
+
+#if DISPATCH_UDP
+UdpTelemetry telemetry(serverIp, TELEMETRY_PORT);
+#endif
 
 void networkInit() {
   DBG(F("  ↳ Configurando Ethernet..."));
@@ -217,7 +662,10 @@ void networkInit() {
   digitalWrite(ETH_CS, HIGH);
   
   Ethernet.init(ETH_CS);
-  // SPI ya fue inicializado en setupHardware()
+  // SPI ya fue inicializado en setupHardware(); el bus USART va aparte
+#if ETH_SPI_USART1
+  EthSpi.begin();
+#endif
 
   DBG(F("  ↳ Configurando IP estática..."));
   // Usar IP estática directamente (sin DHCP) para conexión instantánea
@@ -226,15 +674,20 @@ void networkInit() {
   
   DBG(F("  ↳ Iniciando servidor local..."));
   controlServer.begin();
+
+#if DISPATCH_UDP
+  telemetry.begin(TELEMETRY_PORT);
+  outbox.useUdp(&telemetry, DISPATCH_UDP_ACK);
+#endif
   DBG(F("  ↳ Red lista"));
 }
 
 bool isNetworkConnected() { return connectedOK; }
 
 void setStatusLeds(bool red, bool yellow, bool green) {
-  digitalWrite(LED_ROJO, red ? HIGH : LOW);
-  digitalWrite(LED_AMARILLO, yellow ? HIGH : LOW);
-  digitalWrite(LED_VERDE, green ? HIGH : LOW);
+  FastPin<LED_ROJO>::write(red);
+  FastPin<LED_AMARILLO>::write(yellow);
+  FastPin<LED_VERDE>::write(green);
 }
 
 void resetReconnect() {
@@ -258,6 +711,7 @@ void scheduleReconnectBackoff() {
 
 void reinitEthernet() {
   DBG(F("⚙️ Reinicializando Ethernet..."));
+  backend.close();
   pinMode(ETH_CS, OUTPUT);
   digitalWrite(ETH_CS, HIGH);
   
@@ -268,6 +722,9 @@ void reinitEthernet() {
   delay(100);  // Delay reducido para reinicialización
   
   controlServer.begin();
+#if DISPATCH_UDP
+  telemetry.begin(TELEMETRY_PORT);
+#endif
   DBG(F("✅ Ethernet reinicializado"));
 }
 
@@ -276,6 +733,7 @@ void onServerConnected() {
   nextReconnectMs = 0;
   lastPingReceivedMs = millis();
   resetReconnect();
+  outbox.resume();   // vaciar lo que se acumuló sin conexión
   DBG(F("✅ Conexión servidor establecida/recuperada"));
 }
 
@@ -285,33 +743,31 @@ void onServerDisconnected() {
   DBG(F("❌ Desconectado del servidor"));
 }
 
-bool postJsonToServer(const char* path, const String& body) {
-  EthernetClient cli;
-  cli.setTimeout(500);  // Timeout corto para fire-and-forget
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta TCP para POST"));
-    return false;
+// ====== /connect asíncrono (ver backend_client.h) ======
+// handleReconnection() encola el /connect y el resultado llega a
+// onConnectDone() desde networkUpdate(): ni el connect TCP ni la espera de
+// la respuesta detienen la lectura de los lectores ni la atención de /ping
+bool connectInFlight = false;
+
+void onConnectDone(bool ok) {
+  connectInFlight = false;
+  if (ok) {
+    onServerConnected();
+    // Iniciar el juego automáticamente al (re)conectar
+    if (!isGameRunning()) {
+      gameStart();
+      DBG(F("🎮 Juego iniciado tras conexión"));
+    }
+  } else {
+    DBG(F("❌ No conecta a servidor"));
+    onServerDisconnected();
+    failCount++;
+    if (failCount >= MAX_FAILS_BEFORE_REINIT) {
+      reinitEthernet();
+      failCount = 0;
+    }
+    scheduleReconnectBackoff();
   }
-  
-  cli.print(F("POST "));
-  cli.print(path);
-  cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: "));
-  cli.print(serverIp);
-  cli.print(F(":"));
-  cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: "));
-  cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-  
-  // Fire-and-forget: enviamos y cerramos rápidamente
-  cli.flush();  // Asegura que se envíe todo
-  cli.stop();
-  return true;
 }
 
 bool sendConnect() {
@@ -320,39 +776,9 @@ bool sendConnect() {
   String body = "{\"id\":\"" + String(ARDUINO_ID) + "\",\"ip\":\"" + myIp + "\",\"port\":" + String(ARD_PORT) + "}";
   
   DBG(F("📤 /connect:")); DBG(body);
-  
-  // Intentar conectar con timeout más corto
-  EthernetClient cli;
-  cli.setTimeout(1000);  // Solo 1 segundo para no bloquear mucho
-  
-  if (!cli.connect(serverIp, serverPort)) {
-    DBG(F("❌ No conecta a servidor"));
-    onServerDisconnected();
-    return false;
-  }
-  
-  // Enviar request
-  cli.print(F("POST ")); cli.print(CONNECT_PATH); cli.println(F(" HTTP/1.1"));
-  cli.print(F("Host: ")); cli.print(serverIp); cli.print(F(":")); cli.println(serverPort);
-  cli.println(F("User-Agent: Arduino"));
-  cli.println(F("Content-Type: application/json"));
-  cli.print(F("Content-Length: ")); cli.println(body.length());
-  cli.println(F("Connection: close"));
-  cli.println();
-  cli.print(body);
-  
-  // Esperar respuesta máximo 800ms
-  unsigned long t0 = millis();
-  while (!cli.available() && (millis() - t0 < 800)) {
-    delay(10);
-  }
-  
-  // Leer respuesta
-  while (cli.available()) cli.read();
-  cli.stop();
-  
-  onServerConnected();
-  return true;
+  connectInFlight = backend.post(CONNECT_PATH, body, onConnectDone);
+  if (!connectInFlight) scheduleReconnectBackoff();
+  return connectInFlight;
 }
 
 void checkPingTimeout() {
@@ -363,23 +789,9 @@ void checkPingTimeout() {
 }
 
 void handleReconnection() {
-  if (!connectedOK && (long)(millis() - nextReconnectMs) >= 0) {
+  if (!connectedOK && !connectInFlight && (long)(millis() - nextReconnectMs) >= 0) {
     DBG(F("↻ Intentando /connect..."));
-    if (sendConnect()) {
-      onServerConnected();
-      // Iniciar el juego automáticamente al reconectar
-      if (!isGameRunning()) {
-        gameStart();
-        DBG(F("🎮 Juego iniciado tras reconexión"));
-      }
-    } else {
-      failCount++;
-      if (failCount >= MAX_FAILS_BEFORE_REINIT) {
-        reinitEthernet();
-        failCount = 0;
-      }
-      scheduleReconnectBackoff();
-    }
+    sendConnect();
   }
 }
 
@@ -412,7 +824,7 @@ bool sendDispatchEvent(const char* eventName, const String uids[], bool complete
   body += "}}";
 
   DBG(F("📤 /dispatch:")); DBG(body);
-  return postJsonToServer(DISPATCH_PATH, body);
+  return outbox.push(body, completed, eventName);
 }
 
 String getUptimeISO8601() {
@@ -493,6 +905,70 @@ void handlePingRequest(EthernetClient& c, const String& path) {
   }
 }
 
+void handleStatsRequest(EthernetClient& c, const String& path) {
+  c.println(F("HTTP/1.1 200 OK"));
+  c.println(F("Content-Type: application/json; charset=utf-8"));
+  c.println(F("Connection: close"));
+  c.println();
+  c.print(F("{\"rfid\":{\"pipelined\":")); c.print(RFID_PIPELINED_POLL ? F("true") : F("false"));
+  c.print(F(",\"opLastUs\":")); c.print(rfidScan.stats().opLastUs);
+  c.print(F(",\"opMaxUs\":")); c.print(rfidScan.stats().opMaxUs);
+  c.print(F(",\"budgetUs\":")); c.print(RFID_PASS_BUDGET_US);
+  c.print(F(",\"overruns\":")); c.print(rfidScan.stats().overruns);
+  c.print(F(",\"deferred\":")); c.print(rfidScan.stats().deferred);
+  c.print(F(",\"sweeps\":")); c.print(rfidScan.stats().sweeps);
+  c.print(F(",\"sweepLastUs\":")); c.print(rfidScan.stats().sweepLastUs);
+  c.print(F(",\"fastPresence\":")); c.print(rfidFastEnabled ? F("true") : F("false"));
+  c.print(F(",\"fastTimeoutUs\":")); c.print(RFID_FAST_TIMEOUT_US);
+  c.print(F(",\"fastSavedMs\":")); c.print(rfidFastSavedMs);
+  c.print(F(",\"audits\":")); c.print(rfidScan.stats().audits);
+  c.print(F(",\"auditMisses\":")); c.print(rfidScan.stats().auditMisses);
+  c.print(F(",\"readOk\":")); c.print(rfidReadOk);
+  c.print(F(",\"readFail\":")); c.print(rfidReadFail);
+  c.print(F(",\"irq\":")); c.print(RFID_USE_IRQ ? F("true") : F("false"));
+  c.print(F(",\"irqWakeups\":")); c.print(rfidScan.stats().irqWakeups);
+  c.print(F("},\"spi\":{\"netInterleaves\":")); c.print(spiNetInterleaves);
+  c.print(F(",\"devices\":["));
+  for (uint8_t d = 0; d < SPI_NUM_DEVICES; d++) {
+    if (d == SPI_DEV_ETH) c.print(F("{\"dev\":\"eth\""));
+    else { c.print(F("{\"dev\":\"rfid")); c.print(d - SPI_DEV_RFID0 + 1); c.print('"'); }
+    c.print(F(",\"busyMs\":")); c.print(spiStats[d].busyMs);
+    c.print(F(",\"grants\":")); c.print(spiStats[d].grants);
+    c.print(F(",\"maxHoldUs\":")); c.print(spiStats[d].maxHoldUs);
+    c.print('}');
+    if (d < SPI_NUM_DEVICES - 1) c.print(',');
+  }
+  c.print(F("]},\"net\":{\"bus\":")); c.print(ETH_SPI_USART1 ? F("\"usart1\"") : F("\"shared\""));
+  c.print(F(",\"gapLastUs\":")); c.print(netGapLastUs);
+  c.print(F(",\"gapAvgUs\":")); c.print(netGapAvgUs);
+  c.print(F(",\"gapMaxUs\":")); c.print(netGapMaxUs);
+  c.print(F("},\"outbox\":"));
+  outbox.printJson(c);
+#if DISPATCH_UDP
+  c.print(F(",\"udp\":"));
+  telemetry.printStats(c);
+#endif
+  c.print(F(",\"backend\":"));
+  backend.printStats(c);
+  c.print(F(",\"sched\":"));
+  sched.printStats(c);
+  c.println('}');
+  c.stop();
+
+  // GET /stats?reset=1 reinicia los máximos (para empezar una medición)
+  if (path.indexOf("reset=1") >= 0) {
+    rfidScan.resetMax();
+    netGapMaxUs = 0;
+    for (uint8_t d = 0; d < SPI_NUM_DEVICES; d++) spiStats[d].maxHoldUs = 0;
+    sched.resetStats();
+    backend.resetStats();
+    outbox.resetStats();
+#if DISPATCH_UDP
+    telemetry.resetStats();
+#endif
+  }
+}
+
 void handleControlGet(EthernetClient& c, const String& path) {
   sendHttpResponse400(c, F("Use POST /control"));
   c.stop();
@@ -527,8 +1003,11 @@ void handleControlPost(EthernetClient& c) {
   } else if (body.indexOf("\"command\":\"stop\"") >= 0) {
     gameStop();
     sendHttpResponse200(c, "stop");
+  } else if (body.indexOf("\"command\":\"outbox\"") >= 0) {
+    if (outbox.loadJson(body)) sendHttpResponse200(c, "outbox");
+    else sendHttpResponse400(c, F("Cola invalida: {\"command\":\"outbox\",\"coalesceMs\":20,\"rateMs\":100,\"burst\":4}"));
   } else {
-    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart\"}"));
+    sendHttpResponse400(c, F("JSON debe tener {\"command\":\"start|stop|restart|outbox\"}"));
   }
   
   c.stop();
@@ -555,6 +1034,8 @@ void handleLocalServerRequest() {
 
     if (method == "GET" && (path.startsWith("/Ping") || path.startsWith("/ping"))) {
       handlePingRequest(c, path);
+    } else if (method == "GET" && path.startsWith("/stats")) {
+      handleStatsRequest(c, path);
     } else if (method == "GET" && path.startsWith("/control")) {
       handleControlGet(c, path);
     } else if (method == "POST" && path == "/control") {
@@ -567,9 +1048,24 @@ void handleLocalServerRequest() {
 }
 
 void networkUpdate() {
+  unsigned long now = micros();
+  if (spiNetServiceUs != 0) {
+    netGapLastUs = now - spiNetServiceUs;
+    if (netGapLastUs > netGapMaxUs) netGapMaxUs = netGapLastUs;
+    netGapAvgUs = netGapAvgUs - (netGapAvgUs >> 4) + (netGapLastUs >> 4);
+  }
+
+  spiBusAcquire(SPI_DEV_ETH);
+#if DISPATCH_UDP
+  telemetry.poll();
+#endif
+  outbox.pump(connectedOK);
+  backend.poll();
   handleLocalServerRequest();
   checkPingTimeout();
   handleReconnection();
+  spiBusRelease();
+  spiNetServiceUs = micros();
 }
 
 // ============================================================
@@ -587,7 +1083,8 @@ void setupHardware() {
 
   DBG(F("  ↳ Inicializando bus SPI..."));
   SPI.begin();
-  SPI.setClockDivider(SPI_CLOCK_DIV2);
+  // Sin setClockDivider global: cada acceso usa la configuración de su
+  // dispositivo (ver BUS SPI COMPARTIDO)
 
   DBG(F("  ↳ Inicializando lectores RFID..."));
   // Inicializar lectores RFID
@@ -599,6 +1096,14 @@ void setupHardware() {
     digitalWrite(RST_PINS[i], HIGH);
     rc[i] = new MFRC522(CS_PINS[i], RST_PINS[i]);
     rc[i]->PCD_Init();
+#if RFID_USE_IRQ
+    // IRQ push-pull, activo en bajo, solo por recepción (RxIRq)
+    pinMode(IRQ_PINS[i], INPUT_PULLUP);
+    rc[i]->PCD_WriteRegister(MFRC522::DivIEnReg, 0x80);
+    rc[i]->PCD_WriteRegister(MFRC522::ComIEnReg, 0xA0);
+    *digitalPinToPCMSK(IRQ_PINS[i]) |= bit(digitalPinToPCMSKbit(IRQ_PINS[i]));
+    PCICR |= bit(digitalPinToPCICRbit(IRQ_PINS[i]));
+#endif
     delay(50);  // Pequeño delay entre inicializaciones
     DBGF("     ✓ Lector %d OK", i+1);
   }
@@ -616,6 +1121,50 @@ void updateSystemStatus() {
     setStatusLeds(false, true, false);    // 🟡 esperando start
 }
 
+// ====== TAREAS ======
+// net      : cada pasada, prioridad máxima
+// rfid     : cada pasada, una operación de lector (round-robin no bloqueante)
+// dispatch : por evento, lo levanta rfid cuando hay cambios
+// leds     : cada 50ms
+const unsigned long LEDS_PERIOD_US = 50000;
+
+void taskNetwork() {
+  networkUpdate();
+}
+
+void taskRfid() {
+  // Juego completado o no corriendo → no escanear
+  if (completedLatch || !isGameRunning()) return;
+
+  bool completedNow = false;
+  if (scanRFIDStep(sched.passStartUs(), completedNow)) {
+    dispatchCompleted |= completedNow;
+    sched.signal(taskDispatch);
+  }
+
+  if (completedNow) {
+    completedLatch = true;
+    gameRunning = false;
+    FastPin<LED_GAME>::high();
+    Serial.println(F("🟢 RFID COMPLETADO — esperando restart"));
+  }
+}
+
+void taskDispatchState() {
+  // Se encola también sin conexión: sale en orden al reconectar
+  sendDispatchEvent("rfid:state-changed", lastUID, dispatchCompleted);
+  dispatchCompleted = false;
+}
+
+void setupTasks() {
+  //        nombre          función             tipo             prio período          presupuesto
+  sched.add(F("net"),      taskNetwork,        TASK_EVERY_PASS, 0,   0,                5000);
+  sched.add(F("rfid"),     taskRfid,           TASK_EVERY_PASS, 1,   0,                RFID_PASS_BUDGET_US);
+  taskDispatch =
+  sched.add(F("dispatch"), taskDispatchState,  TASK_EVENT,      2,   0,                20000);
+  sched.add(F("leds"),     updateSystemStatus, TASK_PERIODIC,   3,   LEDS_PERIOD_US,   200);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(1000);  // Esperar a que Serial esté listo
@@ -638,49 +1187,25 @@ void setup() {
   Serial.print(F("📍 IP Local: ")); Serial.println(myIp);
   
   DBG(F("🔗 Intentando conexión al servidor..."));
-  if (sendConnect()) {
+  // En setup sí se espera a que termine el /connect (el juego arranca
+  // desde onConnectDone)
+  sendConnect();
+  while (backend.busy()) backend.poll();
+
+  if (connectedOK) {
     DBG(F("✅ Conexión inicial exitosa"));
-    // Iniciar el juego automáticamente al conectar
-    gameStart();
-    DBG(F("🎮 Juego iniciado automáticamente"));
   } else {
     DBG(F("⚠️ Fallo en conexión inicial - reintentará automáticamente"));
   }
 
   updateSystemStatus();
+  setupTasks();
   DBG(F("✅ Setup completado - entrando en loop"));
   DBG(F("========================================"));
 }
 
 void loop() {
-  // 1. Actualizar interfaz de red (siempre máxima prioridad)
-  networkUpdate();
-
-  // 2. Actualizar LEDs de estado
-  updateSystemStatus();
-
-  // 3. Si el juego está completado o no corriendo, no escanear RFID
-  if (completedLatch || !isGameRunning()) {
-    delay(10);  // Pequeño delay para no saturar CPU
-    return;
-  }
-
-  // 4. Escanear lectores RFID
-  bool completedNow = false;
-  if (scanRFID(completedNow)) {
-    if (isNetworkConnected()) {
-      sendDispatchEvent("rfid:state-changed", lastUID, completedNow);
-    }
-  }
-
-  // 5. Si se completó ahora, marcar el latch
-  if (completedNow) {
-    completedLatch = true;
-    gameRunning = false;
-    digitalWrite(LED_GAME, HIGH);
-    Serial.println(F("🟢 RFID COMPLETADO — esperando restart"));
-  }
-
-  // 6. Pequeño delay para no saturar el bus SPI (reducido para mejor respuesta)
-  delay(50);
-}
\ No newline at end of file
+  // Red, lectores, dispatch y LEDs van como tareas con su propio ritmo.
+  // Sin delay: cada pasada vuelve a atender la red enseguida
+  sched.run();
+}
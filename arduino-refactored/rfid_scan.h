@@ -0,0 +1,343 @@
+// ============================================================
+// MOTOR DE ESCANEO RFID (no bloqueante) para los lectores MFRC522
+//  - Máquina de estados round-robin reanudable: cada llamada a step()
+//    ejecuta como mucho UNA operación de lector (sondeo o lectura de UID)
+//    y vuelve al loop(). Así el /ping espera como máximo una operación
+//    (~25-40ms) y no un barrido completo de 5 lectores (~700ms)
+//  - Pipelined: ARM (REQA a todos) → COLLECT (sin bloquear, hasta que
+//    todos respondan o expire el timer) → READ por cada lector con
+//    tarjeta: un barrido cuesta ~1 timeout de lector en vez de NR
+//  - Sin pipeline: PROBE (PICC_IsNewCardPresent) → READ lector a lector
+//  - UseIrq: ciclos de detección cada RFID_IRQ_DETECT_PERIOD_US y solo se
+//    consultan los lectores que levantaron IRQ
+//  - Presupuesto por pasada: si la red ya consumió RFID_PASS_BUDGET_US la
+//    operación se pospone (deferred); si una operación lo supera, overrun
+//  - Auditoría del perfil rápido: como mucho cada RFID_AUDIT_PERIOD_US, un
+//    lector que acaba de dar vacío con el perfil rápido se vuelve a sondear
+//    con el conservador (STEP_AUDIT). Si aparece tarjeta, el perfil rápido
+//    la perdió: se avisa a Io::auditResult() y se lee igualmente
+//  - No toca el hardware ni el reloj: todo pasa por Io (funciones
+//    estáticas). En rfid.cpp es el MFRC522 sobre el SPI compartido; en
+//    test/ un simulador con tiempos por operación
+// Uso:
+//   struct RfidIo { static unsigned long now(); static bool probe(uint8_t i); ... };
+//   RfidScanEngine<RfidIo, NUM_READERS, RFID_PIPELINED_POLL, RFID_USE_IRQ> rfidScan;
+//   if (rfidScan.step(sched.passStartUs())) { ...cambió algún UID... }
+// ============================================================
+
+#ifndef RFID_SCAN_H
+#define RFID_SCAN_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Presupuesto por pasada del loop(): si la red ya consumió este tiempo,
+// la operación de lector se pospone a la siguiente pasada.
+const unsigned long RFID_PASS_BUDGET_US = 30000;
+// Tope por software de la fase de recogida (mismo margen que la librería,
+// el timer del MFRC522 corta antes: ~25ms con la configuración de PCD_Init)
+const unsigned long RFID_COLLECT_TIMEOUT_US = 36000;
+// Período de los ciclos de detección en modo IRQ
+const unsigned long RFID_IRQ_DETECT_PERIOD_US = 50000;
+// Un HLTA tarda en salir: ~4 bytes a 106kbit/s + margen
+const unsigned long RFID_HLTA_GUARD_US = 500;
+// Una auditoría cuesta un timeout conservador (~25ms): una cada 2s
+const unsigned long RFID_AUDIT_PERIOD_US = 2000000;
+
+// Estadísticas del motor (GET /stats)
+struct RfidScanStats {
+  unsigned long opLastUs;
+  unsigned long opMaxUs;
+  unsigned long overruns;     // operaciones que superaron el presupuesto
+  unsigned long deferred;     // pasadas cedidas a la red
+  unsigned long sweeps;
+  unsigned long sweepLastUs;
+  unsigned long irqWakeups;
+  unsigned long audits;       // sondeos conservadores tras un vacío rápido
+  unsigned long auditMisses;  // ...que encontraron tarjeta
+};
+
+// Io (todas estáticas):
+//   unsigned long now();                     micros()
+//   bool fastEnabled();                      perfil de timer rápido activo
+//   void applyProfile(uint8_t i, bool fast);
+//   void noteFastTimeout();                  sondeo vacío con perfil rápido
+//   void auditResult(uint8_t i, bool missed); auditoría: true si el
+//                                            conservador vio tarjeta
+//   bool presenceDue(uint8_t i);             toca sonda WUPA de presencia
+//   bool presenceResult(uint8_t i, bool p);  true si se dio por retirada
+//   bool wakeupProbe(uint8_t i);             WUPA+HLTA bloqueante
+//   bool probe(uint8_t i);                   PICC_IsNewCardPresent()
+//   bool read(uint8_t i);                    lee y registra el UID; true si cambió
+//   void startRequest(uint8_t i, bool wupa); REQA/WUPA sin esperar
+//   int8_t pollRequest(uint8_t i);           1 tarjeta, 0 vacío, -1 esperando
+//   void startHalt(uint8_t i);               HLTA sin esperar
+//   void interleave();                       punto para atender la red
+//   uint8_t irqFlags(); void clearIrqFlags(); unsigned long irqWindowUs();
+template <class Io, uint8_t NR, bool Pipelined, bool UseIrq>
+class RfidScanEngine {
+  static_assert(NR >= 1 && NR <= 8, "RfidScanEngine: entre 1 y 8 lectores");
+  static_assert(Pipelined || !UseIrq, "RFID_USE_IRQ requiere RFID_PIPELINED_POLL");
+
+public:
+  enum Step : uint8_t {
+    STEP_PROBE,    // secuencial: PICC_IsNewCardPresent() en el lector actual
+    STEP_READ,     // PICC_ReadCardSerial() + registro del UID
+    STEP_ARM,      // pipeline: lanza REQA en todos los lectores
+    STEP_COLLECT,  // pipeline: recoge ComIrqReg/FIFO de cada lector
+    STEP_AUDIT     // REQA con perfil conservador en un lector que dio vacío
+  };
+
+  static const uint8_t ALL_READERS = (1 << NR) - 1;   // bit i = lector i
+
+  RfidScanEngine()
+    : stepNow(FIRST_STEP), reader(0), epoch(0), pending(0), present(0),
+      wupaMask(0), armUs(0), haltUs(0), haltPending(false), auditMask(0),
+      auditNext(0), auditUs(0), sweepStartUs(0) {
+    memset(&st, 0, sizeof(st));
+  }
+
+  // Nueva ronda: vuelve al primer paso (también desde un /control a mitad
+  // de un ARM)
+  void reset() {
+    epoch++;
+    stepNow = FIRST_STEP;
+    reader = 0;
+    pending = 0;
+    present = 0;
+    wupaMask = 0;
+    auditMask = 0;
+    sweepStartUs = Io::now();
+  }
+
+  // Ejecuta como mucho una operación de lector. passStartUs = micros() al
+  // inicio de la pasada del loop(). true si cambió algún UID
+  bool step(unsigned long passStartUs) {
+    if (Io::now() - passStartUs >= RFID_PASS_BUDGET_US) {
+      st.deferred++;
+      return false;
+    }
+
+    bool anyChange = false;
+    bool busy = true;   // false si esta pasada no tocó el bus SPI
+    unsigned long t0 = Io::now();
+
+    switch (stepNow) {
+      case STEP_PROBE:
+        Io::applyProfile(reader, Io::fastEnabled());
+        if (Io::presenceDue(reader)) {
+          anyChange = Io::presenceResult(reader, Io::wakeupProbe(reader));
+          nextReader();
+          break;
+        }
+        if (Io::probe(reader)) {
+          stepNow = STEP_READ;
+        } else if (Io::fastEnabled()) {
+          Io::noteFastTimeout();
+          if (reader == auditNext && auditDue()) {
+            auditUs = Io::now();
+            stepNow = STEP_AUDIT;   // mismo lector, en la próxima pasada
+          } else {
+            nextReader();
+          }
+        } else {
+          nextReader();
+        }
+        break;
+
+      case STEP_AUDIT: {
+        Io::applyProfile(reader, false);
+        bool missed = Io::probe(reader);
+        st.audits++;
+        auditNext = (reader + 1) % NR;
+        if (missed) st.auditMisses++;
+        Io::auditResult(reader, missed);
+        if (missed) stepNow = STEP_READ;
+        else nextReader();
+        break;
+      }
+
+      case STEP_READ:
+        Io::applyProfile(reader, false);  // anticolisión/select: conservador
+        anyChange = Io::read(reader);
+        nextReader();
+        break;
+
+      case STEP_ARM:
+        if (UseIrq) {
+          // Ciclo de detección de bajo duty: entre ciclos no se toca el bus
+          if (Io::now() - armUs < RFID_IRQ_DETECT_PERIOD_US) {
+            busy = false;
+            break;
+          }
+          Io::clearIrqFlags();
+        }
+        // No pisar un HLTA que todavía se está transmitiendo
+        if (haltPending) {
+          if (Io::now() - haltUs < RFID_HLTA_GUARD_US) {
+            busy = false;
+            break;
+          }
+          haltPending = false;
+        }
+        // REQA busca tarjetas nuevas; WUPA confirma las que ya están en HALT
+        wupaMask = 0;
+        for (uint8_t i = 0; i < NR; i++) {
+          Io::applyProfile(i, Io::fastEnabled());
+          bool wupa = Io::presenceDue(i);
+          if (wupa) wupaMask |= (1 << i);
+          Io::startRequest(i, wupa);
+          // Bus libre entre lectores: dejar pasar la red si está esperando.
+          // Si un /control reinició la ronda, este ARM ya no vale.
+          uint8_t e = epoch;
+          Io::interleave();
+          if (e != epoch) return false;
+        }
+        pending = ALL_READERS;
+        present = 0;
+        armUs = Io::now();
+        stepNow = STEP_COLLECT;
+        break;
+
+      case STEP_COLLECT: {
+        uint8_t candidates = pending;
+        unsigned long windowUs = RFID_COLLECT_TIMEOUT_US;
+        if (UseIrq) {
+          // Solo se consultan por SPI los lectores que levantaron IRQ
+          candidates &= Io::irqFlags();
+          windowUs = Io::irqWindowUs();
+          busy = (candidates != 0);
+          if (busy) st.irqWakeups++;
+        }
+        for (uint8_t i = 0; i < NR; i++) {
+          if (!(candidates & (1 << i))) continue;
+          int8_t res = Io::pollRequest(i);
+          if (res < 0) continue;
+          pending &= ~(1 << i);
+          if (res > 0) present |= (1 << i);
+        }
+        // Seguir esperando en la próxima pasada si quedan lectores sin respuesta
+        if (pending && (Io::now() - armUs < windowUs)) break;
+        pending = 0;
+        busy = true;
+        if (Io::fastEnabled() && present != ALL_READERS) {
+          Io::noteFastTimeout();
+          // Candidato a auditoría: un lector vacío que no era sonda WUPA
+          uint8_t empty = ALL_READERS & ~present & ~wupaMask;
+          if (empty && auditDue()) {
+            auditUs = Io::now();
+            for (uint8_t k = 0; k < NR; k++) {
+              uint8_t i = (auditNext + k) % NR;
+              if (empty & (1 << i)) {
+                auditMask = 1 << i;
+                break;
+              }
+            }
+          }
+        }
+
+        // Sondas de presencia: no se leen, solo se confirman y vuelven a HALT
+        for (uint8_t i = 0; i < NR; i++) {
+          if (!(wupaMask & (1 << i))) continue;
+          bool p = present & (1 << i);
+          if (p) startHalt(i);
+          if (Io::presenceResult(i, p)) anyChange = true;
+          present &= ~(1 << i);
+        }
+        wupaMask = 0;
+        readNextPresent();
+        break;
+      }
+    }
+
+    if (!busy) return false;
+
+    st.opLastUs = Io::now() - t0;
+    if (st.opLastUs > st.opMaxUs) st.opMaxUs = st.opLastUs;
+    if (st.opLastUs > RFID_PASS_BUDGET_US) st.overruns++;
+    return anyChange;
+  }
+
+  Step currentStep() const { return stepNow; }
+  uint8_t currentReader() const { return reader; }
+  const RfidScanStats &stats() const { return st; }
+  void resetMax() { st.opMaxUs = 0; }
+
+private:
+  static const Step FIRST_STEP = Pipelined ? STEP_ARM : STEP_PROBE;
+
+  void startHalt(uint8_t i) {
+    Io::startHalt(i);
+    haltUs = Io::now();
+    haltPending = true;
+  }
+
+  void sweepDone() {
+    st.sweeps++;
+    unsigned long now = Io::now();
+    st.sweepLastUs = now - sweepStartUs;
+    sweepStartUs = now;
+  }
+
+  bool auditDue() const {
+    return Io::now() - auditUs >= RFID_AUDIT_PERIOD_US;
+  }
+
+  // Pipeline: pasa al siguiente lector con tarjeta pendiente de leer, luego
+  // a la auditoría pendiente, o cierra el barrido y vuelve a lanzar REQA.
+  void readNextPresent() {
+    for (uint8_t i = 0; i < NR; i++) {
+      if (present & (1 << i)) {
+        reader = i;
+        stepNow = STEP_READ;
+        return;
+      }
+    }
+    for (uint8_t i = 0; i < NR; i++) {
+      if (auditMask & (1 << i)) {
+        auditMask = 0;
+        reader = i;
+        stepNow = STEP_AUDIT;
+        return;
+      }
+    }
+    reader = 0;
+    stepNow = STEP_ARM;
+    sweepDone();
+  }
+
+  void nextReader() {
+    if (Pipelined) {
+      present &= ~(1 << reader);
+      readNextPresent();
+      return;
+    }
+    stepNow = STEP_PROBE;
+    if (++reader >= NR) {
+      reader = 0;
+      sweepDone();
+    }
+  }
+
+  Step stepNow;
+  uint8_t reader;
+  uint8_t epoch;              // cambia en cada reset()
+
+  // Pipeline: bits por lector (bit i = lector i)
+  uint8_t pending;            // REQA lanzado, sin respuesta todavía
+  uint8_t present;            // respondió a REQA, falta leer el UID
+  uint8_t wupaMask;           // lectores sondeados con WUPA (presencia) en este ciclo
+  unsigned long armUs;
+  unsigned long haltUs;
+  bool haltPending;
+
+  // Auditoría del perfil rápido
+  uint8_t auditMask;          // lector a auditar tras las lecturas (pipeline)
+  uint8_t auditNext;          // próximo lector a auditar (rotación)
+  unsigned long auditUs;      // última auditoría
+
+  unsigned long sweepStartUs;
+  RfidScanStats st;
+};
+
+#endif
@@ -0,0 +1,134 @@
+// ============================================================
+// REGLAS DE COMPLETITUD POR MÁSCARA DE BITS
+//  - Una regla = (required, forbidden): se cumple si todos los bits de
+//    required están a 1 y ninguno de forbidden. Los bits que no están en
+//    ninguna de las dos dan igual.
+//  - Evaluar es un AND y una comparación por regla (sin bucles por botón)
+//  - RuleSet<N>: hasta N alternativas; el juego se completa con cualquiera
+//  - Se pueden cambiar en caliente desde POST /control:
+//      {"command":"rule","required":[1,3],"forbidden":[2,4]}
+//    Los botones van numerados desde 1. Sin "forbidden" se prohíben todos
+//    los que no están en required. Con "slot":n se fija solo esa
+//    alternativa; sin slot la regla sustituye a todo el conjunto.
+// ============================================================
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+
+struct MaskRule {
+  uint16_t required;
+  uint16_t forbidden;
+};
+
+inline bool ruleMatches(const MaskRule &r, uint16_t state) {
+  return (state & (r.required | r.forbidden)) == r.required;
+}
+
+template <uint8_t N>
+class RuleSet {
+public:
+  explicit RuleSet(uint8_t numBits) : count(0), allMask((1u << numBits) - 1) {}
+
+  // Índice de la primera regla que se cumple o -1
+  int8_t match(uint16_t state) const {
+    for (uint8_t k = 0; k < count; k++)
+      if (ruleMatches(rules[k], state)) return k;
+    return -1;
+  }
+
+  const MaskRule &get(uint8_t k) const { return rules[k]; }
+  uint8_t size() const { return count; }
+
+  // Regla válida: required no vacía, ambos dentro de los botones y sin solaparse
+  bool valid(const MaskRule &r) const {
+    return r.required && !((r.required | r.forbidden) & ~allMask) && !(r.required & r.forbidden);
+  }
+
+  // Sustituye todo el conjunto por una regla
+  bool set(const MaskRule &r) {
+    if (!valid(r)) return false;
+    rules[0] = r;
+    count = 1;
+    return true;
+  }
+
+  // Fija la alternativa 'slot' (huecos intermedios no permitidos)
+  bool setSlot(uint8_t slot, const MaskRule &r) {
+    if (slot >= N || slot > count || !valid(r)) return false;
+    rules[slot] = r;
+    if (slot == count) count++;
+    return true;
+  }
+
+  // POST /control {"command":"rule",...} → true si se aplicó
+  bool loadJson(const String &body) {
+    MaskRule r;
+    if (!parseList(body, "\"required\"", r.required)) return false;
+    int hasForbidden = body.indexOf("\"forbidden\"");
+    if (hasForbidden >= 0) {
+      if (!parseList(body, "\"forbidden\"", r.forbidden)) return false;
+    } else {
+      r.forbidden = allMask & ~r.required;
+    }
+
+    int s = body.indexOf("\"slot\"");
+    if (s < 0) return set(r);
+    s = body.indexOf(':', s);
+    if (s < 0) return false;
+    return setSlot(body.substring(s + 1).toInt(), r);
+  }
+
+  // [{"required":..,"forbidden":..},...] (máscaras, bit 0 = botón 1)
+  void printJson(Print &out) const {
+    out.print('[');
+    for (uint8_t k = 0; k < count; k++) {
+      out.print(F("{\"required\":")); out.print(rules[k].required);
+      out.print(F(",\"forbidden\":")); out.print(rules[k].forbidden);
+      out.print('}');
+      if (k < count - 1) out.print(',');
+    }
+    out.print(']');
+  }
+
+private:
+  // "key":[n,n,...] con n de 1 a numBits → máscara; false si falta o es inválida
+  bool parseList(const String &body, const char *key, uint16_t &mask) const {
+    int i = body.indexOf(key);
+    if (i < 0) return false;
+    i = body.indexOf('[', i);
+    int end = body.indexOf(']', i);
+    if (i < 0 || end < 0) return false;
+
+    mask = 0;
+    uint8_t n = 0;
+    bool digits = false;
+    for (i = i + 1; i <= end; i++) {
+      char ch = body[i];
+      if (ch >= '0' && ch <= '9') {
+        n = n * 10 + (ch - '0');
+        digits = true;
+        if (n > 16) return false;
+      } else if (ch == ',' || ch == ']') {
+        if (digits) {
+          if (n < 1 || !(allMask & (1u << (n - 1)))) return false;
+          mask |= 1u << (n - 1);
+        } else if (ch == ',') {
+          return false;
+        }
+        n = 0;
+        digits = false;
+      } else if (ch != ' ') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  MaskRule rules[N];
+  uint8_t count;
+  uint16_t allMask;
+};
+
+#endif
@@ -0,0 +1,205 @@
+// ============================================================
+// PLANIFICADOR COOPERATIVO (time-triggered) para los sketches
+//  - Tareas de 3 tipos: cada pasada, periódicas y por evento
+//  - Prioridad fija (0 = máxima): en cada pasada se ejecutan, en orden de
+//    prioridad, todas las tareas listas
+//  - Presupuesto por tarea: si una ejecución lo supera cuenta como overrun
+//  - Deadlines: una tarea periódica que arranca con un período entero de
+//    retraso pierde esa(s) activación(es) → missed
+//  - Jitter = retraso entre la activación teórica y el arranque real
+//  - signal() es solo para el loop (escribe dueUs, 32 bits). Desde una ISR
+//    signalFromIsr(): levanta un único byte y run() apunta la activación
+//    cuando lo ve (el jitter de esas tareas cuenta desde ahí)
+// Uso:
+//   Scheduler<4> sched;
+//   sched.add(F("net"), networkTask, TASK_EVERY_PASS, 0, 0, 5000);
+//   void loop() { sched.run(); }
+//   ISR(...) { ...; sched.signalFromIsr(taskScan); }
+// ============================================================
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+typedef void (*TaskFn)();
+
+enum TaskKind : uint8_t {
+  TASK_EVERY_PASS,   // se ejecuta en todas las pasadas (p.ej. red)
+  TASK_PERIODIC,     // cada periodUs
+  TASK_EVENT         // solo cuando alguien llama a signal()
+};
+
+struct TaskStats {
+  unsigned long runs;
+  unsigned long overruns;      // ejecuciones que superaron budgetUs
+  unsigned long missed;        // activaciones periódicas perdidas
+  unsigned long lastRunUs;
+  unsigned long maxRunUs;
+  unsigned long lastJitterUs;
+  unsigned long maxJitterUs;
+};
+
+struct Task {
+  const __FlashStringHelper *name;
+  TaskFn fn;
+  TaskKind kind;
+  uint8_t priority;
+  unsigned long periodUs;
+  unsigned long budgetUs;
+  unsigned long dueUs;         // próxima activación (periódicas) o señal
+  bool signaled;               // señal del loop (con dueUs)
+  volatile bool isrSignaled;   // señal de una ISR (solo este byte)
+  bool enabled;
+  TaskStats stats;
+};
+
+template <uint8_t N>
+class Scheduler {
+public:
+  Scheduler() : count(0), passes(0), passStart(0), maxPassUs(0) {}
+
+  // Devuelve el id de la tarea o -1 si no hay hueco
+  int8_t add(const __FlashStringHelper *name, TaskFn fn, TaskKind kind,
+             uint8_t priority, unsigned long periodUs, unsigned long budgetUs) {
+    if (count >= N) return -1;
+
+    Task &t = tasks[count];
+    t.name = name;
+    t.fn = fn;
+    t.kind = kind;
+    t.priority = priority;
+    t.periodUs = periodUs;
+    t.budgetUs = budgetUs;
+    t.dueUs = micros() + periodUs;
+    t.signaled = false;
+    t.isrSignaled = false;
+    t.enabled = true;
+    memset(&t.stats, 0, sizeof(t.stats));
+
+    // Orden de ejecución por prioridad (inserción estable)
+    order[count] = count;
+    for (uint8_t k = count; k > 0 && tasks[order[k - 1]].priority > priority; k--) {
+      uint8_t tmp = order[k - 1];
+      order[k - 1] = order[k];
+      order[k] = tmp;
+    }
+    return count++;
+  }
+
+  // Solo desde el loop
+  void signal(uint8_t id) {
+    if (id >= count) return;
+    if (!tasks[id].signaled) tasks[id].dueUs = micros();
+    tasks[id].signaled = true;
+  }
+
+  // Desde una ISR: una escritura de un byte, atómica en AVR
+  void signalFromIsr(uint8_t id) {
+    if (id < count) tasks[id].isrSignaled = true;
+  }
+
+  void enable(uint8_t id, bool on) {
+    if (id >= count) return;
+    tasks[id].enabled = on;
+    if (on) tasks[id].dueUs = micros() + tasks[id].periodUs;
+  }
+
+  // Una pasada: ejecuta en orden de prioridad todas las tareas listas
+  void run() {
+    passStart = micros();
+    for (uint8_t k = 0; k < count; k++) {
+      Task &t = tasks[order[k]];
+      if (!t.enabled) continue;
+
+      unsigned long now = micros();
+      unsigned long jitter = 0;
+
+      switch (t.kind) {
+        case TASK_EVERY_PASS:
+          break;
+
+        case TASK_PERIODIC: {
+          if ((long)(now - t.dueUs) < 0) continue;
+          jitter = now - t.dueUs;
+          unsigned long late = jitter / t.periodUs;   // activaciones perdidas
+          t.stats.missed += late;
+          t.dueUs += (late + 1) * t.periodUs;
+          break;
+        }
+
+        case TASK_EVENT:
+          // Una señal de la ISR que llegue tras borrar el byte se junta con
+          // esta ejecución o queda para la siguiente pasada
+          if (t.isrSignaled) {
+            t.isrSignaled = false;
+            if (!t.signaled) t.dueUs = now;
+            t.signaled = true;
+          }
+          if (!t.signaled) continue;
+          t.signaled = false;
+          jitter = now - t.dueUs;
+          break;
+      }
+
+      t.fn();
+
+      unsigned long ran = micros() - now;
+      TaskStats &st = t.stats;
+      st.runs++;
+      st.lastRunUs = ran;
+      if (ran > st.maxRunUs) st.maxRunUs = ran;
+      if (ran > t.budgetUs) st.overruns++;
+      st.lastJitterUs = jitter;
+      if (jitter > st.maxJitterUs) st.maxJitterUs = jitter;
+    }
+
+    passes++;
+    unsigned long passUs = micros() - passStart;
+    if (passUs > maxPassUs) maxPassUs = passUs;
+  }
+
+  // micros() al inicio de la pasada actual (presupuestos dentro de tareas)
+  unsigned long passStartUs() const { return passStart; }
+
+  // Estadísticas en JSON: {"passes":..,"maxPassUs":..,"tasks":[...]}
+  void printStats(Print &out) const {
+    out.print(F("{\"passes\":")); out.print(passes);
+    out.print(F(",\"maxPassUs\":")); out.print(maxPassUs);
+    out.print(F(",\"tasks\":["));
+    for (uint8_t k = 0; k < count; k++) {
+      const Task &t = tasks[order[k]];
+      const TaskStats &st = t.stats;
+      out.print(F("{\"name\":\"")); out.print(t.name);
+      out.print(F("\",\"prio\":")); out.print(t.priority);
+      out.print(F(",\"periodUs\":")); out.print(t.periodUs);
+      out.print(F(",\"budgetUs\":")); out.print(t.budgetUs);
+      out.print(F(",\"runs\":")); out.print(st.runs);
+      out.print(F(",\"overruns\":")); out.print(st.overruns);
+      out.print(F(",\"missed\":")); out.print(st.missed);
+      out.print(F(",\"lastRunUs\":")); out.print(st.lastRunUs);
+      out.print(F(",\"maxRunUs\":")); out.print(st.maxRunUs);
+      out.print(F(",\"lastJitterUs\":")); out.print(st.lastJitterUs);
+      out.print(F(",\"maxJitterUs\":")); out.print(st.maxJitterUs);
+      out.print('}');
+      if (k < count - 1) out.print(',');
+    }
+    out.print(F("]}"));
+  }
+
+  void resetStats() {
+    for (uint8_t k = 0; k < count; k++) memset(&tasks[k].stats, 0, sizeof(TaskStats));
+    passes = 0;
+    maxPassUs = 0;
+  }
+
+private:
+  Task tasks[N];
+  uint8_t order[N];            // índices de tasks ordenados por prioridad
+  uint8_t count;
+  unsigned long passes;
+  unsigned long passStart;
+  unsigned long maxPassUs;
+};
+
+#endif
@@ -0,0 +1,114 @@
+// ============================================================
+// COLA SPSC SIN BLOQUEOS (ISR → loop) para AVR
+//  - Un solo productor (p.ej. las ISR, que en AVR no se anidan) y un solo
+//    consumidor (una tarea del loop). Nunca se deshabilitan interrupciones.
+//  - Índices volatile de 8 bits: en AVR leerlos/escribirlos es una sola
+//    instrucción (atómica). Una barrera de compilador entre el dato y la
+//    publicación del índice evita que se reordenen (AVR no reordena en
+//    hardware; fuera de AVR la barrera es una fence completa)
+//  - Capacidad útil N-1 (un hueco distingue llena de vacía); N potencia de 2
+//  - push() con la cola llena descarta y cuenta drop; pushOverwrite()
+//    sustituye el último encolado (el estado final nunca se pierde)
+// Uso:
+//   SpscQueue<BtnEvent, 32> q;
+//   ISR(...)   { q.push(ev); }
+//   loop       { BtnEvent ev; while (q.pop(ev)) { ... } }
+// ============================================================
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+
+#if defined(__AVR__)
+  #define SPSC_BARRIER() asm volatile("" ::: "memory")
+#else
+  #define SPSC_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+template <typename T, uint8_t N>
+class SpscQueue {
+  static_assert(N >= 4 && N <= 128 && (N & (N - 1)) == 0, "SpscQueue: N potencia de 2 entre 4 y 128");
+
+public:
+  SpscQueue() : head(0), tail(0), dropCount(0), maxDepthSeen(0) {}
+
+  static constexpr uint8_t capacity() { return N - 1; }
+
+  // ---- Productor ----
+
+  // false (y drop) si está llena
+  bool push(const T &v) {
+    uint8_t h = head;
+    uint8_t next = (h + 1) & (N - 1);
+    if (next == tail) {
+      dropCount++;
+      return false;
+    }
+    buf[h] = v;
+    SPSC_BARRIER();   // dato escrito antes de publicarlo
+    head = next;
+    return true;
+  }
+
+  // Llena: sobrescribe el último encolado (cuenta drop). Con N >= 4 ese
+  // hueco nunca es el que el consumidor puede estar copiando.
+  void pushOverwrite(const T &v) {
+    uint8_t h = head;
+    uint8_t next = (h + 1) & (N - 1);
+    if (next == tail) {
+      buf[(h - 1) & (N - 1)] = v;
+      dropCount++;
+      return;
+    }
+    buf[h] = v;
+    SPSC_BARRIER();
+    head = next;
+  }
+
+  // ---- Consumidor ----
+
+  bool pop(T &out) {
+    uint8_t t = tail;
+    uint8_t h = head;
+    if (t == h) return false;
+    uint8_t depth = (h - t) & (N - 1);
+    if (depth > maxDepthSeen) maxDepthSeen = depth;
+    SPSC_BARRIER();   // leer el dato después de ver el índice
+    out = buf[t];
+    SPSC_BARRIER();   // y liberar el hueco después de copiarlo
+    tail = (t + 1) & (N - 1);
+    return true;
+  }
+
+  // Descarta todo lo pendiente
+  void clear() { tail = head; }
+
+  uint8_t size() const { return (uint8_t)(head - tail) & (N - 1); }
+  bool empty() const { return head == tail; }
+
+  // ---- Estadísticas (consumidor) ----
+
+  // dropCount es de 16 bits y lo escribe el productor: se relee hasta
+  // obtener dos lecturas iguales en vez de bloquear interrupciones
+  uint16_t drops() const {
+    uint16_t a, b;
+    do {
+      a = dropCount;
+      b = dropCount;
+    } while (a != b);
+    return a;
+  }
+
+  uint8_t maxDepth() const { return maxDepthSeen; }
+  void resetMaxDepth() { maxDepthSeen = 0; }
+
+private:
+  T buf[N];
+  volatile uint8_t head;         // lo escribe el productor
+  volatile uint8_t tail;         // lo escribe el consumidor
+  volatile uint16_t dropCount;   // lo escribe el productor
+  uint8_t maxDepthSeen;          // lo escribe el consumidor
+};
+
+#endif
@@ -0,0 +1,76 @@
+// ============================================================
+// PRUEBA EN HOST de adc_windows.h
+//  - Para los 1024 códigos de cada canal, la comparación entera
+//    adcLo <= adc <= adcHi da lo mismo que la de ohmios en float
+//    (R_MIN <= R <= R_MAX, con R calculada en ejecución)
+//  - Ninguna ventana queda vacía y no se solapan entre canales
+//  - Imprime las ventanas en códigos ADC
+// Uso:
+//   make -C arduino-refactored/test
+// ============================================================
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../adc_windows.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                   \
+  do {                                                     \
+    if (!(cond)) {                                         \
+      failures++;                                          \
+      printf("FALLO %s:%d: ", __FILE__, __LINE__);         \
+      printf(__VA_ARGS__);                                 \
+      printf("\n");                                        \
+    }                                                      \
+  } while (0)
+
+// El antiguo adcToOhms(), en ejecución
+static float adcToOhms(uint16_t adc) {
+  if (adc == 0) return 0.0f;
+  if (adc >= 1023) return 1e12f;
+  volatile float rref = RREF;
+  return rref * (float)adc / (1023.0f - (float)adc);
+}
+
+static void testMatchesOhms(uint8_t ch) {
+  uint16_t lo = adcLo(ch), hi = adcHi(ch);
+  unsigned mismatches = 0;
+  for (uint16_t adc = 0; adc < 1024; adc++) {
+    float r = adcToOhms(adc);
+    bool ohms = r >= R_MIN[ch] && r <= R_MAX[ch];
+    bool codes = adc >= lo && adc <= hi;
+    if (ohms != codes) {
+      mismatches++;
+      if (mismatches <= 3)
+        CHECK(false, "canal %u, adc %u: %.1f ohm %s, ventana %u-%u",
+              ch, adc, r, ohms ? "dentro" : "fuera", lo, hi);
+    }
+  }
+  CHECK(mismatches == 0, "canal %u: %u códigos distintos", ch, mismatches);
+}
+
+static void testWindows() {
+  for (uint8_t ch = 0; ch < ADC_WINDOWS; ch++) {
+    CHECK(adcLo(ch) <= adcHi(ch), "canal %u: ventana vacía (%u-%u)", ch, adcLo(ch), adcHi(ch));
+    if (ch > 0)
+      CHECK(adcHi(ch - 1) < adcLo(ch), "canales %u y %u solapados", ch - 1, ch);
+  }
+}
+
+int main() {
+  for (uint8_t ch = 0; ch < ADC_WINDOWS; ch++) testMatchesOhms(ch);
+  testWindows();
+
+  printf("adc_windows_test: ventanas");
+  for (uint8_t ch = 0; ch < ADC_WINDOWS; ch++)
+    printf(" %u-%u", adcLo(ch), adcHi(ch));
+  printf("\n");
+
+  if (failures) {
+    printf("adc_windows_test: %d fallos\n", failures);
+    return 1;
+  }
+  printf("adc_windows_test: OK\n");
+  return 0;
+}
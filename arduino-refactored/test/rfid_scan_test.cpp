@@ -0,0 +1,270 @@
+// ============================================================
+// PRUEBA EN HOST de rfid_scan.h
+//  - SimIo: 5 lectores simulados sobre un reloj virtual; cada operación
+//    suma al reloj lo que tarda en el MFRC522 real (SPI + timeout del timer)
+//  - Con todos los lectores vacíos: una sola operación bloqueante por
+//    pasada y ninguna pasada por encima de RFID_PASS_BUDGET_US, en los
+//    modos secuencial, pipeline e IRQ y con los dos perfiles de timer
+//  - Red lenta: si la pasada ya gastó el presupuesto no se toca el lector
+//  - Una tarjeta puesta se lee y step() lo reporta
+//  - Una tarjeta que el perfil rápido no ve la encuentra la auditoría con
+//    el perfil conservador, que la lee y avisa con auditResult()
+// Uso:
+//   make -C arduino-refactored/test
+// ============================================================
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../rfid_scan.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                   \
+  do {                                                     \
+    if (!(cond)) {                                         \
+      failures++;                                          \
+      printf("FALLO %s:%d: ", __FILE__, __LINE__);         \
+      printf(__VA_ARGS__);                                 \
+      printf("\n");                                        \
+    }                                                      \
+  } while (0)
+
+const uint8_t NR = 5;
+
+// ====== Tiempos del lector simulado (µs) ======
+const unsigned long SPI_REG_US = 10;          // un acceso a registro
+const unsigned long FAST_TIMEOUT_US = 1000;
+const unsigned long CONSERVATIVE_TIMEOUT_US = 25025;
+const unsigned long ATQA_US = 100;            // respuesta de una tarjeta al REQA
+const unsigned long READ_UID_US = 8000;       // anticolisión + select
+
+// ====== Io simulado ======
+struct SimIo {
+  static unsigned long clock;
+  static bool fast;
+  static uint8_t fastMask;
+  static uint8_t cards;                       // bit i: tarjeta en el lector i
+  static uint8_t known;                       // UID ya registrado
+  static uint8_t fastBlind;                   // bit i: con perfil rápido no se ve la tarjeta
+  static unsigned long auditMisses;
+  static unsigned long armedAt[NR];
+  static unsigned long blockingOps;           // transceive bloqueantes
+  static unsigned long touches;               // cualquier acceso a un lector
+
+  static void reset(bool fastProfile) {
+    clock = 1000000;
+    fast = fastProfile;
+    fastMask = 0;
+    cards = known = fastBlind = 0;
+    blockingOps = touches = auditMisses = 0;
+  }
+
+  static unsigned long timeoutUs() { return fast ? FAST_TIMEOUT_US : CONSERVATIVE_TIMEOUT_US; }
+
+  static unsigned long now() { return clock; }
+  static bool fastEnabled() { return fast; }
+
+  static void applyProfile(uint8_t i, bool f) {
+    if (((fastMask >> i) & 1) == (f ? 1 : 0)) return;
+    touches++;
+    clock += 5 * SPI_REG_US;
+    if (f) fastMask |= (1 << i);
+    else fastMask &= ~(1 << i);
+  }
+
+  static void noteFastTimeout() {}
+  static void auditResult(uint8_t, bool missed) { if (missed) auditMisses++; }
+
+  // Tarjeta visible para un REQA con el perfil cargado en el lector i
+  static bool sees(uint8_t i) {
+    if (!(cards & (1 << i))) return false;
+    return !((fastMask & fastBlind) & (1 << i));
+  }
+  static bool presenceDue(uint8_t) { return false; }
+  static bool presenceResult(uint8_t, bool) { return false; }
+
+  // Transceive bloqueante: con tarjeta responde enseguida, vacío espera
+  // al timer del perfil cargado en ese lector
+  static bool transceive(uint8_t i) {
+    touches++;
+    blockingOps++;
+    clock += 12 * SPI_REG_US;
+    bool card = sees(i);
+    clock += card ? ATQA_US : ((fastMask & (1 << i)) ? FAST_TIMEOUT_US : CONSERVATIVE_TIMEOUT_US);
+    return card;
+  }
+
+  static bool wakeupProbe(uint8_t i) { return transceive(i); }
+  static bool probe(uint8_t i) { return transceive(i); }
+
+  static bool read(uint8_t i) {
+    touches++;
+    blockingOps++;
+    clock += READ_UID_US;
+    if (!(cards & (1 << i)) || (known & (1 << i))) return false;
+    known |= (1 << i);
+    return true;
+  }
+
+  static void startRequest(uint8_t i, bool) {
+    touches++;
+    clock += 12 * SPI_REG_US;
+    armedAt[i] = clock;
+  }
+
+  static int8_t pollRequest(uint8_t i) {
+    touches++;
+    clock += 4 * SPI_REG_US;
+    unsigned long waited = clock - armedAt[i];
+    if (sees(i)) return waited >= ATQA_US ? 1 : -1;
+    return waited >= ((fastMask & (1 << i)) ? FAST_TIMEOUT_US : CONSERVATIVE_TIMEOUT_US) ? 0 : -1;
+  }
+
+  static void startHalt(uint8_t) { touches++; clock += 6 * SPI_REG_US; }
+  static void interleave() {}
+
+  // Con IRQ solo avisan los lectores que recibieron respuesta
+  static uint8_t irqFlags() {
+    uint8_t f = 0;
+    for (uint8_t i = 0; i < NR; i++)
+      if (sees(i) && clock - armedAt[i] >= ATQA_US) f |= (1 << i);
+    return f;
+  }
+  static void clearIrqFlags() {}
+  static unsigned long irqWindowUs() { return timeoutUs() + 500; }
+};
+
+unsigned long SimIo::clock;
+bool SimIo::fast;
+uint8_t SimIo::fastMask;
+uint8_t SimIo::cards;
+uint8_t SimIo::known;
+uint8_t SimIo::fastBlind;
+unsigned long SimIo::auditMisses;
+unsigned long SimIo::armedAt[NR];
+unsigned long SimIo::blockingOps;
+unsigned long SimIo::touches;
+
+// ====== Pasadas del loop() ======
+
+// Una pasada: la red gasta netUs y después el motor da un paso
+template <class Engine>
+static bool pass(Engine &eng, unsigned long netUs, unsigned long &stepUs, unsigned long &ops) {
+  unsigned long passStart = SimIo::clock;
+  SimIo::clock += netUs;
+  unsigned long t0 = SimIo::clock;
+  unsigned long ops0 = SimIo::blockingOps;
+  bool changed = eng.step(passStart);
+  stepUs = SimIo::clock - t0;
+  ops = SimIo::blockingOps - ops0;
+  SimIo::clock += 200;   // resto del loop()
+  return changed;
+}
+
+// Lectores vacíos: una operación bloqueante por pasada como mucho y el
+// paso nunca supera el presupuesto; además los barridos avanzan
+template <bool Pipelined, bool UseIrq>
+static void testEmptyBudget(bool fastProfile) {
+  const char *mode = UseIrq ? "irq" : (Pipelined ? "pipeline" : "secuencial");
+  const char *prof = fastProfile ? "rápido" : "conservador";
+  SimIo::reset(fastProfile);
+  RfidScanEngine<SimIo, NR, Pipelined, UseIrq> eng;
+  eng.reset();
+
+  unsigned long maxStepUs = 0, maxOps = 0;
+  for (int k = 0; k < 2000; k++) {
+    unsigned long stepUs, ops;
+    bool changed = pass(eng, (k * 37) % 3000, stepUs, ops);   // red: 0..3ms
+    CHECK(!changed, "%s/%s: cambio sin tarjetas", mode, prof);
+    if (stepUs > maxStepUs) maxStepUs = stepUs;
+    if (ops > maxOps) maxOps = ops;
+  }
+
+  CHECK(maxOps <= 1, "%s/%s: %lu operaciones bloqueantes en una pasada", mode, prof, maxOps);
+  CHECK(maxStepUs <= RFID_PASS_BUDGET_US, "%s/%s: paso de %lu µs > presupuesto %lu",
+        mode, prof, maxStepUs, RFID_PASS_BUDGET_US);
+  CHECK(eng.stats().overruns == 0, "%s/%s: %lu overruns", mode, prof, eng.stats().overruns);
+  CHECK(eng.stats().sweeps > 10, "%s/%s: solo %lu barridos", mode, prof, eng.stats().sweeps);
+
+  printf("%-10s %-11s paso máx %5lu µs, barrido %6lu µs, %lu barridos\n",
+         mode, prof, maxStepUs, eng.stats().sweepLastUs, eng.stats().sweeps);
+}
+
+// Si la red ya se comió el presupuesto, el motor no toca los lectores
+template <bool Pipelined>
+static void testDeferred() {
+  SimIo::reset(true);
+  RfidScanEngine<SimIo, NR, Pipelined, false> eng;
+  eng.reset();
+  unsigned long stepUs, ops;
+  unsigned long touches0 = SimIo::touches;
+  pass(eng, RFID_PASS_BUDGET_US, stepUs, ops);
+  CHECK(SimIo::touches == touches0 && stepUs == 0, "deferred: se tocó un lector");
+  CHECK(eng.stats().deferred == 1, "deferred: %lu", eng.stats().deferred);
+}
+
+// Una tarjeta en el lector 3 se lee en pocas pasadas
+template <bool Pipelined, bool UseIrq>
+static void testCardDetected() {
+  SimIo::reset(true);
+  RfidScanEngine<SimIo, NR, Pipelined, UseIrq> eng;
+  eng.reset();
+  SimIo::cards = 1 << 2;
+  int passes = 0;
+  bool changed = false;
+  while (!changed && passes < 500) {
+    unsigned long stepUs, ops;
+    changed = pass(eng, 500, stepUs, ops);
+    passes++;
+  }
+  CHECK(changed && SimIo::known == (1 << 2), "tarjeta no leída tras %d pasadas", passes);
+}
+
+// El perfil rápido no ve la tarjeta del lector 4: la auditoría sí
+template <bool Pipelined, bool UseIrq>
+static void testFastMissAudited() {
+  SimIo::reset(true);
+  RfidScanEngine<SimIo, NR, Pipelined, UseIrq> eng;
+  eng.reset();
+  SimIo::cards = SimIo::fastBlind = 1 << 3;
+  int passes = 0;
+  bool changed = false;
+  unsigned long maxStepUs = 0;
+  while (!changed && passes < 20000) {
+    unsigned long stepUs, ops;
+    changed = pass(eng, 500, stepUs, ops);
+    if (stepUs > maxStepUs) maxStepUs = stepUs;
+    passes++;
+  }
+  CHECK(changed && SimIo::known == (1 << 3), "auditoría %d%d: tarjeta no leída tras %d pasadas", Pipelined, UseIrq, passes);
+  CHECK(SimIo::auditMisses >= 1 && eng.stats().auditMisses == SimIo::auditMisses,
+        "auditoría: %lu fallos avisados, %lu contados", SimIo::auditMisses, eng.stats().auditMisses);
+  CHECK(maxStepUs <= RFID_PASS_BUDGET_US, "auditoría: paso de %lu µs", maxStepUs);
+}
+
+int main() {
+  testEmptyBudget<false, false>(false);
+  testEmptyBudget<false, false>(true);
+  testEmptyBudget<true, false>(false);
+  testEmptyBudget<true, false>(true);
+  testEmptyBudget<true, true>(false);
+  testEmptyBudget<true, true>(true);
+
+  testDeferred<false>();
+  testDeferred<true>();
+
+  testCardDetected<false, false>();
+  testCardDetected<true, false>();
+  testCardDetected<true, true>();
+
+  testFastMissAudited<false, false>();
+  testFastMissAudited<true, false>();
+  testFastMissAudited<true, true>();
+
+  if (failures) {
+    printf("rfid_scan_test: %d fallos\n", failures);
+    return 1;
+  }
+  printf("rfid_scan_test: OK\n");
+  return 0;
+}
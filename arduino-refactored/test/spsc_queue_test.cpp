@@ -0,0 +1,138 @@
+// ============================================================
+// PRUEBA EN HOST de spsc_queue.h
+//  - Un hilo productor (hace de ISR) contra un consumidor (hace de loop)
+//  - Comprueba orden FIFO, que no se pierde ni se duplica nada y que
+//    drops() coincide con los push rechazados o sobrescritos
+// Uso:
+//   make -C arduino-refactored/test
+// ============================================================
+
+#include <stdio.h>
+#include <stdint.h>
+#include <thread>
+#include <atomic>
+#include "../spsc_queue.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                   \
+  do {                                                     \
+    if (!(cond)) {                                         \
+      failures++;                                          \
+      printf("FALLO %s:%d: ", __FILE__, __LINE__);         \
+      printf(__VA_ARGS__);                                 \
+      printf("\n");                                        \
+    }                                                      \
+  } while (0)
+
+// drops() es de 16 bits: cada ronda se queda por debajo del desborde
+const uint32_t ITEMS = 60000;
+const int ROUNDS = 20;
+
+// Espera activa de 0..n vueltas y, de vez en cuando, ceder el hilo (con
+// una sola CPU es lo que intercala productor y consumidor): alterna cola
+// llena y vacía
+static void jitter(uint32_t &rng, uint32_t n) {
+  rng = rng * 1103515245u + 12345u;
+  if (((rng >> 8) & 15) == 0) std::this_thread::yield();
+  for (volatile uint32_t k = (rng >> 16) % (n + 1); k; k--) {}
+}
+
+// ====== Un solo hilo ======
+
+static void testSingleThread() {
+  SpscQueue<uint32_t, 8> q;
+  uint32_t v;
+  CHECK(q.empty() && !q.pop(v), "vacía al crearse");
+
+  for (uint32_t i = 0; i < q.capacity(); i++) CHECK(q.push(i), "push %u", i);
+  CHECK(!q.push(99), "llena: push rechazado");
+  CHECK(q.drops() == 1, "drops %u", q.drops());
+
+  q.pushOverwrite(100);   // sustituye al último (6)
+  CHECK(q.drops() == 2, "drops %u", q.drops());
+
+  const uint32_t expect[] = { 0, 1, 2, 3, 4, 5, 100 };
+  for (uint32_t e : expect) {
+    CHECK(q.pop(v) && v == e, "pop %u, esperado %u", v, e);
+  }
+  CHECK(q.empty() && !q.pop(v), "vacía al final");
+  CHECK(q.maxDepth() == 7, "maxDepth %u", q.maxDepth());
+}
+
+// ====== Productor y consumidor concurrentes ======
+
+// El productor encola 0..ITEMS-1; el consumidor debe verlos en orden
+// estrictamente creciente y recibidos + drops == ITEMS
+static void stressRound(bool overwrite, uint32_t producerJitter, uint32_t consumerJitter,
+                        uint32_t &totalReceived, uint32_t &totalDrops) {
+  SpscQueue<uint32_t, 16> q;
+  std::atomic<bool> start(false), done(false);
+  uint32_t rejected = 0;
+
+  std::thread producer([&] {
+    uint32_t rng = producerJitter;
+    while (!start.load()) std::this_thread::yield();
+    for (uint32_t i = 0; i < ITEMS; i++) {
+      if (overwrite) q.pushOverwrite(i);
+      else if (!q.push(i)) rejected++;
+      jitter(rng, producerJitter);
+    }
+    done.store(true);
+  });
+
+  uint32_t received = 0, last = 0, outOfOrder = 0;
+  uint32_t rng = consumerJitter + 1;
+  bool first = true;
+  uint32_t v;
+  start.store(true);
+  for (;;) {
+    bool finished = done.load();   // antes del pop: tras esto no llega nada nuevo
+    if (q.pop(v)) {
+      if (!first && v <= last) outOfOrder++;
+      last = v;
+      first = false;
+      received++;
+      jitter(rng, consumerJitter);
+    } else if (finished) {
+      break;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  const char *mode = overwrite ? "pushOverwrite" : "push";
+  CHECK(outOfOrder == 0, "%s: %u fuera de orden o duplicados", mode, outOfOrder);
+  CHECK(received + q.drops() == ITEMS, "%s: recibidos %u + drops %u != %u",
+        mode, received, q.drops(), ITEMS);
+  if (!overwrite) CHECK(q.drops() == rejected, "push: drops %u, rechazados %u", q.drops(), rejected);
+  // Con pushOverwrite el último encolado nunca se pierde
+  if (overwrite) CHECK(last == ITEMS - 1, "pushOverwrite: último %u", last);
+
+  totalReceived += received;
+  totalDrops += q.drops();
+}
+
+static void testStress(bool overwrite) {
+  uint32_t received = 0, drops = 0;
+  for (int r = 0; r < ROUNDS; r++) {
+    // Productor más rápido, igual y más lento que el consumidor
+    stressRound(overwrite, (r % 3) * 40, ((r + 1) % 3) * 40, received, drops);
+  }
+  printf("%-14s %d rondas: recibidos %u, drops %u\n",
+         overwrite ? "pushOverwrite" : "push", ROUNDS, received, drops);
+  CHECK(drops > 0 && received > ROUNDS * ITEMS / 20, "la prueba no llenó ni vació la cola");
+}
+
+int main() {
+  testSingleThread();
+  testStress(false);
+  testStress(true);
+  if (failures) {
+    printf("spsc_queue_test: %d fallos\n", failures);
+    return 1;
+  }
+  printf("spsc_queue_test: OK\n");
+  return 0;
+}
@@ -0,0 +1,495 @@
+#!/usr/bin/env python3
+# Ciclos de CPU de la lectura de botones de scanButtons() y de los LEDs de
+# updateSystemStatus(), antes (digitalRead/digitalWrite del core) y después
+# (fast_gpio.h), sin placa ni avr-gcc:
+#  - Los cuerpos del bloque GPIO_BENCH de arduino-code.cpp y las funciones
+#    del core (wiring_digital.c, tablas de pins_arduino.h "mega") están aquí
+#    escritos en LLVM IR; se compilan con opt -Os + llc para ATmega2560
+#  - El ensamblador resultante se ejecuta en un simulador con los ciclos del
+#    ATmega2560 (PC de 3 bytes). Se imprime lo mismo que gpioBenchmark():
+#    ciclos de la función menos los de la llamada vacía
+#  - avr-gcc -Os puede diferir en unos pocos ciclos por llamada; con placa,
+#    GPIO_BENCH 1 en arduino-code.cpp da la medida real
+# Uso:
+#   arduino-refactored/tools/gpio-cycles.py [--asm]
+# Requiere opt y llc de LLVM con el target AVR (llc --version | grep avr).
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+# ====== Tablas del core (pins_arduino.h, variante mega) ======
+# Puertos del core: PA=1..PH=8, PJ=10, PK=11, PL=12 (0 = NOT_A_PORT)
+PORTS = dict(A=1, B=2, C=3, D=4, E=5, F=6, G=7, H=8, J=10, K=11, L=12)
+PIN_ADDR = dict(A=0x20, B=0x23, C=0x26, D=0x29, E=0x2C, F=0x2F, G=0x32,
+                H=0x100, J=0x103, K=0x106, L=0x109)
+MEGA_PINS = (
+    "E0 E1 E4 E5 G5 E3 H3 H4 H5 H6 B4 B5 B6 B7 J1 J0 H1 H0 D3 D2 D1 D0 "
+    "A0 A1 A2 A3 A4 A5 A6 A7 C7 C6 C5 C4 C3 C2 C1 C0 D7 G2 G1 G0 "
+    "L7 L6 L5 L4 L3 L2 L1 L0 B3 B2 B1 B0 F0 F1 F2 F3 F4 F5 F6 F7 "
+    "K0 K1 K2 K3 K4 K5 K6 K7").split()
+# pin -> TIMERnX (enum de Arduino.h)
+PIN_TIMER = {2: 10, 3: 11, 4: 2, 5: 9, 6: 12, 7: 13, 8: 14, 9: 8, 10: 7,
+             11: 3, 12: 4, 13: 1, 44: 18, 45: 17, 46: 16}
+# TIMERnX -> (TCCRnA, bit COMnX1) que limpia turnOffPWM()
+TIMER_TCCR = {1: (0x44, 7), 2: (0x44, 5), 3: (0x80, 7), 4: (0x80, 5),
+              5: (0x80, 3), 6: (0xB0, 7), 7: (0xB0, 7), 8: (0xB0, 5),
+              9: (0x90, 7), 10: (0x90, 5), 11: (0x90, 3), 12: (0xA0, 7),
+              13: (0xA0, 5), 14: (0xA0, 3), 15: (0xA0, 3), 16: (0x120, 7),
+              17: (0x120, 5), 18: (0x120, 3)}
+
+# ====== Código (LLVM IR) ======
+# Las lecturas de PROGMEM son volatile: pgm_read_byte() es asm opaco para
+# avr-gcc y no se puede plegar a constante.
+CODE = r'''
+define internal i8 @pgm(i8 addrspace(1)* %base, i8 %pin) addrspace(1) alwaysinline {
+  %i = zext i8 %pin to i16
+  %a = getelementptr i8, i8 addrspace(1)* %base, i16 %i
+  %v = load volatile i8, i8 addrspace(1)* %a
+  ret i8 %v
+}
+define internal i8* @pgmreg(i16 addrspace(1)* %base, i8 %port) addrspace(1) alwaysinline {
+  %i = zext i8 %port to i16
+  %a = getelementptr i16, i16 addrspace(1)* %base, i16 %i
+  %v = load volatile i16, i16 addrspace(1)* %a
+  %p = inttoptr i16 %v to i8*
+  ret i8* %p
+}
+
+; int digitalRead(uint8_t pin)
+define i16 @digitalRead(i8 %pin) addrspace(1) noinline {
+entry:
+  %timer = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @timer_PGM, i16 0, i16 0), i8 %pin)
+  %bit = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @mask_PGM, i16 0, i16 0), i8 %pin)
+  %port = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @port_PGM, i16 0, i16 0), i8 %pin)
+  %np = icmp eq i8 %port, 0
+  br i1 %np, label %low, label %chk
+chk:
+  %ht = icmp ne i8 %timer, 0
+  br i1 %ht, label %off, label %rd
+off:
+  call addrspace(1) void @turnOffPWM(i8 %timer)
+  br label %rd
+rd:
+  %reg = call addrspace(1) i8* @pgmreg(i16 addrspace(1)* getelementptr ([13 x i16], [13 x i16] addrspace(1)* @input_PGM, i16 0, i16 0), i8 %port)
+  %v = load volatile i8, i8* %reg
+  %m = and i8 %v, %bit
+  %z = icmp eq i8 %m, 0
+  br i1 %z, label %low, label %high
+high:
+  ret i16 1
+low:
+  ret i16 0
+}
+
+; void digitalWrite(uint8_t pin, uint8_t val)
+define void @digitalWrite(i8 %pin, i8 %val) addrspace(1) noinline {
+entry:
+  %timer = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @timer_PGM, i16 0, i16 0), i8 %pin)
+  %bit = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @mask_PGM, i16 0, i16 0), i8 %pin)
+  %port = call addrspace(1) i8 @pgm(i8 addrspace(1)* getelementptr ([70 x i8], [70 x i8] addrspace(1)* @port_PGM, i16 0, i16 0), i8 %pin)
+  %np = icmp eq i8 %port, 0
+  br i1 %np, label %ret, label %chk
+chk:
+  %ht = icmp ne i8 %timer, 0
+  br i1 %ht, label %off, label %wr
+off:
+  call addrspace(1) void @turnOffPWM(i8 %timer)
+  br label %wr
+wr:
+  %out = call addrspace(1) i8* @pgmreg(i16 addrspace(1)* getelementptr ([13 x i16], [13 x i16] addrspace(1)* @output_PGM, i16 0, i16 0), i8 %port)
+  %sreg = load volatile i8, i8* inttoptr (i16 95 to i8*)
+  call addrspace(1) void asm sideeffect "cli", "~{memory}"()
+  %o = load volatile i8, i8* %out
+  %lowv = icmp eq i8 %val, 0
+  br i1 %lowv, label %clr, label %set
+clr:
+  %nb = xor i8 %bit, -1
+  %c = and i8 %o, %nb
+  store volatile i8 %c, i8* %out
+  br label %fin
+set:
+  %s = or i8 %o, %bit
+  store volatile i8 %s, i8* %out
+  br label %fin
+fin:
+  store volatile i8 %sreg, i8* inttoptr (i16 95 to i8*)
+  br label %ret
+ret:
+  ret void
+}
+
+@benchSink = global i16 0
+@benchPins = internal global [10 x i8] c"\15\14\13\12\11\10\0F\0E\02\03"
+
+define void @benchEmpty() addrspace(1) noinline {
+  ret void
+}
+
+; Antes: for (i < 10) if (digitalRead(pins[i]) == LOW) m |= 1u << i;
+define void @benchReadCore() addrspace(1) noinline {
+entry:
+  br label %loop
+loop:
+  %i = phi i8 [0, %entry], [%i1, %loop]
+  %m = phi i16 [0, %entry], [%m2, %loop]
+  %ix = zext i8 %i to i16
+  %pa = getelementptr [10 x i8], [10 x i8]* @benchPins, i16 0, i16 %ix
+  %pin = load i8, i8* %pa
+  %r = call addrspace(1) i16 @digitalRead(i8 %pin)
+  %lo = icmp eq i16 %r, 0
+  %sh = shl i16 1, %ix
+  %or = or i16 %m, %sh
+  %m2 = select i1 %lo, i16 %or, i16 %m
+  %i1 = add i8 %i, 1
+  %d = icmp eq i8 %i1, 10
+  br i1 %d, label %exit, label %loop, !llvm.loop !0
+exit:
+  store volatile i16 %m2, i16* @benchSink
+  ret void
+}
+
+; Después: ~ButtonPins::read() & BTN_MASK_ALL
+; (PinGroup<21,20,19,18,17,16,15,14,2,3>: una lectura de PIND, PINE, PINH
+; y PINJ, y FastioGather reparte los bits)
+define internal i16 @bitof(i8 %snap, i8 %mask, i16 %out) addrspace(1) alwaysinline {
+  %a = and i8 %snap, %mask
+  %z = icmp ne i8 %a, 0
+  %r = select i1 %z, i16 %out, i16 0
+  ret i16 %r
+}
+define void @benchReadFast() addrspace(1) noinline {
+  %d = load volatile i8, i8* inttoptr (i16 41 to i8*)
+  %e = load volatile i8, i8* inttoptr (i16 44 to i8*)
+  %h = load volatile i8, i8* inttoptr (i16 256 to i8*)
+  %j = load volatile i8, i8* inttoptr (i16 259 to i8*)
+  %b0 = call addrspace(1) i16 @bitof(i8 %d, i8 1, i16 1)
+  %b1 = call addrspace(1) i16 @bitof(i8 %d, i8 2, i16 2)
+  %b2 = call addrspace(1) i16 @bitof(i8 %d, i8 4, i16 4)
+  %b3 = call addrspace(1) i16 @bitof(i8 %d, i8 8, i16 8)
+  %b4 = call addrspace(1) i16 @bitof(i8 %h, i8 1, i16 16)
+  %b5 = call addrspace(1) i16 @bitof(i8 %h, i8 2, i16 32)
+  %b6 = call addrspace(1) i16 @bitof(i8 %j, i8 1, i16 64)
+  %b7 = call addrspace(1) i16 @bitof(i8 %j, i8 2, i16 128)
+  %b8 = call addrspace(1) i16 @bitof(i8 %e, i8 16, i16 256)
+  %b9 = call addrspace(1) i16 @bitof(i8 %e, i8 32, i16 512)
+  %o1 = or i16 %b0, %b1
+  %o2 = or i16 %o1, %b2
+  %o3 = or i16 %o2, %b3
+  %o4 = or i16 %o3, %b4
+  %o5 = or i16 %o4, %b5
+  %o6 = or i16 %o5, %b6
+  %o7 = or i16 %o6, %b7
+  %o8 = or i16 %o7, %b8
+  %o9 = or i16 %o8, %b9
+  %n = xor i16 %o9, 1023
+  store volatile i16 %n, i16* @benchSink
+  ret void
+}
+
+; Antes: digitalWrite(LED_ROJO=5, LOW); (LED_AMARILLO=6, HIGH); (LED_VERDE=7, LOW)
+define void @benchLedsCore() addrspace(1) noinline {
+  call addrspace(1) void @digitalWrite(i8 5, i8 0)
+  call addrspace(1) void @digitalWrite(i8 6, i8 1)
+  call addrspace(1) void @digitalWrite(i8 7, i8 0)
+  ret void
+}
+
+; Después: setStatusLeds(false, true, false)
+; PE3 con cbi; PH3/PH4 fuera del rango de sbi/cbi → fastioUpdate()
+define void @benchLedsFast() addrspace(1) noinline {
+  %e = load volatile i8, i8* inttoptr (i16 46 to i8*)
+  %e1 = and i8 %e, -9
+  store volatile i8 %e1, i8* inttoptr (i16 46 to i8*)
+  %s1 = load volatile i8, i8* inttoptr (i16 95 to i8*)
+  call addrspace(1) void asm sideeffect "cli", "~{memory}"()
+  %h = load volatile i8, i8* inttoptr (i16 258 to i8*)
+  %h1 = or i8 %h, 8
+  store volatile i8 %h1, i8* inttoptr (i16 258 to i8*)
+  store volatile i8 %s1, i8* inttoptr (i16 95 to i8*)
+  %s2 = load volatile i8, i8* inttoptr (i16 95 to i8*)
+  call addrspace(1) void asm sideeffect "cli", "~{memory}"()
+  %h2 = load volatile i8, i8* inttoptr (i16 258 to i8*)
+  %h3 = and i8 %h2, -17
+  store volatile i8 %h3, i8* inttoptr (i16 258 to i8*)
+  store volatile i8 %s2, i8* inttoptr (i16 95 to i8*)
+  ret void
+}
+
+; avr-gcc -Os no desenrolla este bucle
+!0 = distinct !{!0, !1}
+!1 = !{!"llvm.loop.unroll.disable"}
+'''
+
+
+def progmem(name, vals, ty='i8'):
+    body = ", ".join(f"{ty} {v}" for v in vals)
+    return f"@{name} = internal addrspace(1) constant [{len(vals)} x {ty}] [{body}]\n"
+
+
+def turn_off_pwm():
+    ir = ["define internal void @turnOffPWM(i8 %t) addrspace(1) noinline {",
+          "  switch i8 %t, label %done ["]
+    ir += [f"    i8 {t}, label %c{t}" for t in TIMER_TCCR]
+    ir.append("  ]")
+    for t, (reg, bit) in TIMER_TCCR.items():
+        ir.append(f"c{t}:\n"
+                  f"  %v{t} = load volatile i8, i8* inttoptr (i16 {reg} to i8*)\n"
+                  f"  %n{t} = and i8 %v{t}, {0xff ^ (1 << bit)}\n"
+                  f"  store volatile i8 %n{t}, i8* inttoptr (i16 {reg} to i8*)\n"
+                  f"  br label %done")
+    ir.append("done:\n  ret void\n}\n")
+    return "\n".join(ir)
+
+
+def module():
+    inp = [0] * 13
+    outp = [0] * 13
+    for k, v in PORTS.items():
+        inp[v] = PIN_ADDR[k]
+        outp[v] = PIN_ADDR[k] + 2
+    return ('target datalayout = "e-P1-p:16:8-i8:8-i16:8-i32:8-i64:8-f32:8-f64:8-n8-a:8"\n'
+            'target triple = "avr-atmel-none"\n'
+            + progmem("port_PGM", [PORTS[p[0]] for p in MEGA_PINS])
+            + progmem("mask_PGM", [1 << int(p[1]) for p in MEGA_PINS])
+            + progmem("timer_PGM", [PIN_TIMER.get(i, 0) for i in range(len(MEGA_PINS))])
+            + progmem("input_PGM", inp, 'i16')
+            + progmem("output_PGM", outp, 'i16')
+            + turn_off_pwm() + CODE)
+
+
+def compile_avr():
+    with tempfile.TemporaryDirectory() as d:
+        ll = os.path.join(d, "bench.ll")
+        opt_ll = os.path.join(d, "bench.opt.ll")
+        asm = os.path.join(d, "bench.s")
+        with open(ll, "w") as f:
+            f.write(module())
+        subprocess.check_call(["opt", "-Os", ll, "-S", "-o", opt_ll])
+        subprocess.check_call(["llc", "-march=avr", "-mcpu=atmega2560", "-O2", opt_ll, "-o", asm])
+        with open(asm) as f:
+            return f.read()
+
+
+# ====== Simulador (solo las instrucciones que genera llc aquí) ======
+class Avr:
+    # Ciclos del ATmega2560 (PC de 3 bytes); saltos condicionales 1/2
+    CYCLES = dict(lpm=3, ld=2, st=2, lds=2, sts=2, push=2, pop=2, cbi=2, sbi=2,
+                  rjmp=2, call=5, ret=5)
+
+    def __init__(self, asm):
+        self.code, self.labels, data = [], {}, {}
+        cur = None
+        for raw in asm.splitlines():
+            line = raw.split(';')[0].strip()
+            if not line:
+                continue
+            m = re.match(r'^([.\w]+):$', line)
+            if m:
+                cur = m.group(1)
+                self.labels[cur] = len(self.code)
+                continue
+            if line.startswith('.'):
+                d = line.split(None, 1)
+                if d[0] in ('.ascii', '.asciz'):
+                    b = d[1][1:-1].encode('latin1').decode('unicode_escape').encode('latin1')
+                    data[cur] = data.get(cur, b'') + b + (b'\0' if d[0] == '.asciz' else b'')
+                elif d[0] == '.short':
+                    v = int(d[1], 0) & 0xffff
+                    data[cur] = data.get(cur, b'') + bytes([v & 0xff, v >> 8])
+                continue
+            parts = line.split(None, 1)
+            ops = [o.strip() for o in parts[1].split(',')] if len(parts) > 1 else []
+            self.code.append((parts[0], ops))
+
+        # Tablas PROGMEM en flash, el resto en RAM
+        self.flash, self.ram = bytearray(0x4000), bytearray(0x2200)
+        self.addr = {}
+        fa, ra = 0x1000, 0x0300
+        for name, b in data.items():
+            if name.endswith('_PGM'):
+                self.addr[name] = fa
+                self.flash[fa:fa + len(b)] = b
+                fa += len(b) + 16
+            else:
+                self.addr[name] = ra
+                self.ram[ra:ra + len(b)] = b
+                ra += len(b) + 16
+        self.r = [0] * 32
+        self.f = dict(C=0, Z=0, N=0, V=0)
+        self.sp = 0x21FF
+
+    def val(self, e):
+        neg = e.startswith('-')
+        if neg:
+            e = e[1:]
+        m = re.match(r'(lo8|hi8)\((\w+)\)', e)
+        if m:
+            a = self.addr[m.group(2)]
+            if neg:                      # -lo8(x) == lo8(-x)
+                a, neg = -a & 0xffff, False
+            v = a & 0xff if m.group(1) == 'lo8' else a >> 8
+        else:
+            m = re.match(r'(\w+)\+(\d+)$', e)
+            if m and m.group(1) in self.addr:
+                v = self.addr[m.group(1)] + int(m.group(2))
+            else:
+                v = self.addr[e] if e in self.addr else int(e, 0)
+        return -v if neg else v
+
+    def zn(self, v):
+        self.f['Z'], self.f['N'] = int(v == 0), v >> 7
+
+    def sub(self, a, b, c=0, keepz=False):
+        v = (a - b - c) & 0xff
+        z = int(v == 0)
+        self.f.update(C=int(a < b + c), V=((a ^ b) & (a ^ v) & 0x80) >> 7,
+                      Z=(self.f['Z'] & z) if keepz else z, N=v >> 7)
+        return v
+
+    def ptr(self, n):
+        p = {'X': 26, 'Y': 28, 'Z': 30}[n]
+        return self.r[p] | self.r[p + 1] << 8
+
+    # Ciclos desde el call hasta el ret de 'entry', ambos incluidos
+    def call(self, entry, **regs):
+        r, f = self.r, self.f
+        r[1] = 0
+        for k, v in regs.items():
+            r[int(k[1:])] = v
+        pc, stack, cycles = self.labels[entry], [], self.CYCLES['call']
+        while True:
+            op, a = self.code[pc]
+            pc += 1
+            c = self.CYCLES.get(op, 1)
+            d = int(a[0][1:]) if a and re.match(r'r\d+$', a[0]) else None
+            if op == 'ldi':
+                r[d] = self.val(a[1]) & 0xff
+            elif op == 'mov':
+                r[d] = r[int(a[1][1:])]
+            elif op == 'movw':
+                s = int(a[1][1:])
+                r[d], r[d + 1] = r[s], r[s + 1]
+            elif op == 'clr':
+                r[d] = 0
+                f.update(Z=1, N=0, V=0)
+            elif op in ('subi', 'sbci', 'cpi'):
+                v = self.sub(r[d], self.val(a[1]) & 0xff, f['C'] if op == 'sbci' else 0, op == 'sbci')
+                if op != 'cpi':
+                    r[d] = v
+            elif op == 'cpc':
+                self.sub(r[d], r[int(a[1][1:])], f['C'], True)
+            elif op in ('and', 'andi', 'or', 'ori', 'eor'):
+                k = self.val(a[1]) & 0xff if op.endswith('i') else r[int(a[1][1:])]
+                r[d] = {'and': r[d] & k, 'andi': r[d] & k, 'or': r[d] | k,
+                        'ori': r[d] | k, 'eor': r[d] ^ k}[op]
+                self.zn(r[d])
+                f['V'] = 0
+            elif op == 'com':
+                r[d] ^= 0xff
+                self.zn(r[d])
+                f.update(C=1, V=0)
+            elif op in ('inc', 'dec'):
+                r[d] = (r[d] + (1 if op == 'inc' else -1)) & 0xff
+                self.zn(r[d])
+                f['V'] = int(r[d] == (0x80 if op == 'inc' else 0x7f))
+            elif op in ('lsl', 'rol'):
+                cin = f['C'] if op == 'rol' else 0
+                f['C'] = r[d] >> 7
+                r[d] = ((r[d] << 1) | cin) & 0xff
+                self.zn(r[d])
+                f['V'] = f['N'] ^ f['C']
+            elif op == 'swap':
+                r[d] = ((r[d] << 4) | (r[d] >> 4)) & 0xff
+            elif op == 'lpm':
+                z = self.ptr('Z')
+                r[d] = self.flash[z]
+                if a[1] == 'Z+':
+                    r[30], r[31] = (z + 1) & 0xff, (z + 1) >> 8
+            elif op == 'ld':
+                r[d] = self.ram[self.ptr(a[1])]
+            elif op == 'st':
+                self.ram[self.ptr(a[0])] = r[int(a[1][1:])]
+            elif op == 'lds':
+                r[d] = self.ram[self.val(a[1])]
+            elif op == 'sts':
+                self.ram[self.val(a[0])] = r[int(a[1][1:])]
+            elif op == 'in':
+                r[d] = self.ram[self.val(a[1]) + 0x20]
+            elif op == 'out':
+                self.ram[self.val(a[0]) + 0x20] = r[int(a[1][1:])]
+            elif op in ('cbi', 'sbi'):
+                io, b = self.val(a[0]) + 0x20, 1 << self.val(a[1])
+                self.ram[io] = (self.ram[io] & ~b) if op == 'cbi' else (self.ram[io] | b)
+            elif op == 'cli':
+                pass
+            elif op == 'push':
+                self.ram[self.sp] = r[d]
+                self.sp -= 1
+            elif op == 'pop':
+                self.sp += 1
+                r[d] = self.ram[self.sp]
+            elif op == 'rjmp':
+                pc = self.labels[a[0]]
+            elif op in ('breq', 'brne', 'brge', 'brlt', 'brmi', 'brpl'):
+                s = f['N'] ^ f['V']
+                if {'breq': f['Z'], 'brne': not f['Z'], 'brge': not s,
+                        'brlt': s, 'brmi': f['N'], 'brpl': not f['N']}[op]:
+                    c = 2
+                    pc = self.labels[a[0]]
+            elif op == 'call':
+                stack.append(pc)
+                pc = self.labels[a[0]]
+            elif op == 'ret':
+                cycles += c
+                if not stack:
+                    return cycles
+                pc = stack.pop()
+                continue
+            else:
+                raise SystemExit(f"gpio-cycles: instrucción no soportada: {op}")
+            cycles += c
+
+    def pins(self, d=0xFF, e=0xFF, h=0xFF, j=0xFF):
+        self.ram[0x29], self.ram[0x2C], self.ram[0x100], self.ram[0x103] = d, e, h, j
+
+    def sink(self):
+        a = self.addr['benchSink']
+        return self.ram[a] | self.ram[a + 1] << 8
+
+
+def main():
+    asm = compile_avr()
+    if '--asm' in sys.argv:
+        print(asm)
+        return
+    cpu = Avr(asm)
+
+    # Misma máscara por los dos caminos: D0, D2 (botones 1 y 3), J1 (8) y E5 (10)
+    cpu.pins(d=0xFA, e=0xDF, j=0xFD)
+    cpu.call('benchReadCore')
+    core = cpu.sink()
+    cpu.call('benchReadFast')
+    if cpu.sink() != core or core != 0x285:
+        raise SystemExit(f"gpio-cycles: máscaras distintas {core:#x} / {cpu.sink():#x}")
+
+    cpu.pins()   # botones sueltos (pull-up)
+    base = cpu.call('benchEmpty')
+    cyc = {fn: cpu.call(fn) - base for fn in
+           ('benchReadCore', 'benchReadFast', 'benchLedsCore', 'benchLedsFast')}
+    us = lambda c: c / 16.0
+    print("Ciclos de CPU (core → fast_gpio), 16 MHz:")
+    print(f"   scanButtons, lectura 10 pines:  {cyc['benchReadCore']} → {cyc['benchReadFast']}"
+          f"  ({us(cyc['benchReadCore']):.1f} µs → {us(cyc['benchReadFast']):.1f} µs)")
+    print(f"   updateSystemStatus, 3 LEDs:     {cyc['benchLedsCore']} → {cyc['benchLedsFast']}"
+          f"  ({us(cyc['benchLedsCore']):.1f} µs → {us(cyc['benchLedsFast']):.1f} µs)")
+    for pin in (21, 2, 3):
+        print(f"   digitalRead({pin}): {cpu.call('digitalRead', r24=pin) - base}")
+    for pin, v in ((5, 0), (6, 1), (7, 0)):
+        print(f"   digitalWrite({pin}): {cpu.call('digitalWrite', r24=pin, r22=v) - base}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,65 @@
+#!/bin/sh
+# Parchea una instalación de EthernetENC para que el bus SPI del ENC28J60
+# lo elija el sketch (ETH_SPI_USART1 en eth_spi.h). Solo hace falta una vez
+# por instalación; volver a ejecutarlo no cambia nada.
+#
+# Uso:
+#   tools/patch-ethernetenc.sh [ruta/a/libraries/EthernetENC]
+#   tools/patch-ethernetenc.sh --revert [ruta]
+#
+# Por defecto: ~/Arduino/libraries/EthernetENC
+
+set -e
+
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+REVERT=0
+if [ "$1" = "--revert" ]; then
+  REVERT=1
+  shift
+fi
+LIB=${1:-"$HOME/Arduino/libraries/EthernetENC"}
+DRIVER="$LIB/src/utility/Enc28J60Network.cpp"
+MARK="// eth_spi_port: bus SPI elegido por el sketch"
+
+if [ ! -f "$DRIVER" ]; then
+  echo "No se encuentra $DRIVER" >&2
+  exit 1
+fi
+
+if [ "$REVERT" = 1 ]; then
+  if [ -f "$DRIVER.orig" ]; then
+    mv "$DRIVER.orig" "$DRIVER"
+    rm -f "$LIB/src/utility/eth_spi_port.h"
+    echo "EthernetENC restaurada"
+  else
+    echo "EthernetENC no estaba parcheada"
+  fi
+  exit 0
+fi
+
+if grep -q "$MARK" "$DRIVER"; then
+  cp "$HERE/eth_spi_port.h" "$LIB/src/utility/"
+  echo "EthernetENC ya estaba parcheada (eth_spi_port.h actualizado)"
+  exit 0
+fi
+
+# El parche solo redirige el objeto SPI: un acceso directo a registros del
+# SPI por hardware se saltaría el puerto
+if grep -Eq '\bSP(DR|SR|CR)\b' "$DRIVER"; then
+  echo "$DRIVER accede directamente a SPDR/SPSR/SPCR: versión no soportada" >&2
+  exit 1
+fi
+
+cp "$DRIVER" "$DRIVER.orig"
+cp "$HERE/eth_spi_port.h" "$LIB/src/utility/"
+{
+  echo "$MARK"
+  echo '#include "eth_spi_port.h"'
+  echo 'extern const uint8_t ethSpiPortLinked = 1;'
+  echo 'static EthSpiPort EthSpiShim;'
+  echo '#define SPI EthSpiShim'
+  echo
+  cat "$DRIVER.orig"
+} > "$DRIVER"
+
+echo "EthernetENC parcheada: $DRIVER"
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Latencia de /ping durante el escaneo RFID, para comparar bus compartido
+# y bus USART1 (ETH_SPI_USART1). Ejecutar con el juego corriendo (lectores
+# escaneando), una vez con cada firmware, y pegar las dos filas en
+# LATENCY-FIX.md.
+#
+# Uso:
+#   tools/ping-bench.sh <ip-del-arduino> [pings=500] [puerto=8080]
+
+set -e
+
+IP=$1
+N=${2:-500}
+PORT=${3:-8080}
+if [ -z "$IP" ]; then
+  echo "Uso: $0 <ip-del-arduino> [pings] [puerto]" >&2
+  exit 1
+fi
+BASE="http://$IP:$PORT"
+TMP=$(mktemp)
+trap 'rm -f "$TMP"' EXIT
+
+curl -s -o /dev/null "$BASE/stats?reset=1"
+
+i=0
+while [ "$i" -lt "$N" ]; do
+  curl -s -o /dev/null -w '%{time_total}\n' --max-time 3 "$BASE/ping?time=$i" >> "$TMP" || echo 3 >> "$TMP"
+  i=$((i + 1))
+done
+
+STATS=$(curl -s "$BASE/stats")
+BUS=$(echo "$STATS" | sed -n 's/.*"bus":"\([a-z0-9]*\)".*/\1/p')
+GAP_AVG=$(echo "$STATS" | sed -n 's/.*"gapAvgUs":\([0-9]*\).*/\1/p')
+GAP_MAX=$(echo "$STATS" | sed -n 's/.*"gapMaxUs":\([0-9]*\).*/\1/p')
+
+# | bus | pings | p50 ms | p95 ms | máx ms | gapAvgUs | gapMaxUs |
+sort -n "$TMP" | awk -v bus="$BUS" -v ga="$GAP_AVG" -v gm="$GAP_MAX" '
+  { t[NR] = $1 * 1000 }
+  END {
+    p50 = t[int(NR * 0.50 + 0.5)]; p95 = t[int(NR * 0.95 + 0.5)];
+    printf "| %s | %d | %.1f | %.1f | %.1f | %s | %s |\n", bus, NR, p50, p95, t[NR], ga, gm
+  }'
@@ -0,0 +1,177 @@
+// ============================================================
+// TELEMETRÍA POR UDP para los eventos de /dispatch
+//  - Un datagrama por evento, sin TCP ni cabeceras HTTP: para cambios de
+//    estado frecuentes en los que perder uno no importa (el siguiente
+//    lleva el estado completo)
+//  - Los completados pueden ir con confirmación: se reenvían cada
+//    UDP_RETX_MS hasta recibir el ACK del servidor o agotar UDP_MAX_TX
+//    envíos. Hay como mucho uno esperando ACK
+//  - Datagrama (v1, enteros little-endian):
+//      [0..1] 'S','T'  marca
+//      [2]    flags    bit0 = pide ACK
+//      [3..4] seq      uint16; cada evento nuevo suma 1, un reenvío repite
+//      [5..]  JSON     el mismo cuerpo que POST /dispatch
+//                      {"arduinoId":..,"event":..,"data":{..}}
+//    ACK del servidor (al puerto de origen): 'S','A', 0, seq (2 bytes)
+//  - El servidor solo aplica un seq posterior al último aplicado de ese
+//    Arduino (con vuelta a 0): descarta los reenvíos cuyo ACK se perdió,
+//    así un completado no se procesa dos veces, y los estados que llegan
+//    desordenados. Si se agotan los envíos y la cola vuelve a pedir el
+//    mismo cuerpo, se repite el seq (DispatchQueue no envía nada detrás
+//    de un crítico sin confirmar)
+// Uso:
+//   UdpTelemetry telemetry(serverIp, TELEMETRY_PORT);
+//   telemetry.begin(TELEMETRY_PORT);
+//   telemetry.send(body);                       // sin ACK
+//   telemetry.sendReliable(body, done);         // con ACK → done(ok)
+//   void networkUpdate() { telemetry.poll(); ... }
+// ============================================================
+
+#ifndef UDP_TELEMETRY_H
+#define UDP_TELEMETRY_H
+
+#include <Arduino.h>
+#include <EthernetENC.h>
+#include <EthernetUdp.h>
+#include <string.h>
+#include "backend_client.h"   // HttpDoneFn
+
+const unsigned long UDP_RETX_MS = 200;
+const uint8_t UDP_MAX_TX = 5;
+const uint8_t UDP_FLAG_ACK = 0x01;
+
+struct UdpStats {
+  unsigned long sent;         // datagramas nuevos
+  unsigned long retransmits;  // reenvíos de completados
+  unsigned long acked;        // completados confirmados
+  unsigned long unacked;      // completados sin ACK tras UDP_MAX_TX
+  unsigned long errors;       // beginPacket/endPacket fallidos
+};
+
+class UdpTelemetry {
+public:
+  UdpTelemetry(const IPAddress &ip, uint16_t port)
+    : ip(ip), port(port), seq(0), ackActive(false), ackFailed(false), ackSeq(0),
+      txCount(0), lastTxMs(0), ackDone(nullptr) {
+    memset(&st, 0, sizeof(st));
+  }
+
+  // También tras reinicializar Ethernet
+  bool begin(uint16_t localPort) {
+    udp.stop();
+    return udp.begin(localPort);
+  }
+
+  // Sin confirmación
+  bool send(const String &body) {
+    bool ok = sendPacket(++seq, 0, body);
+    if (ok) st.sent++;
+    return ok;
+  }
+
+  // Con ACK y reenvío. false si ya hay uno esperando ACK
+  bool sendReliable(const String &body, HttpDoneFn done) {
+    if (ackActive) return false;
+    if (!(ackFailed && body == ackBody)) {
+      ackBody = body;
+      ackSeq = ++seq;
+    }
+    ackFailed = false;
+    ackDone = done;
+    ackActive = true;
+    txCount = 0;
+    st.sent++;
+    transmit();
+    return true;
+  }
+
+  // Cada pasada: ACKs recibidos y reenvíos
+  void poll() {
+    while (udp.parsePacket() > 0) {
+      uint8_t buf[5];
+      int len = udp.read(buf, sizeof(buf));
+      if (len == 5 && buf[0] == 'S' && buf[1] == 'A' && ackActive &&
+          (uint16_t)(buf[3] | (buf[4] << 8)) == ackSeq) {
+        st.acked++;
+        finishReliable(true);
+      }
+    }
+
+    if (ackActive && millis() - lastTxMs >= UDP_RETX_MS) {
+      if (txCount >= UDP_MAX_TX) {
+        st.unacked++;
+        finishReliable(false);
+      } else {
+        st.retransmits++;
+        transmit();
+      }
+    }
+  }
+
+  bool busy() const { return ackActive; }
+  const UdpStats &stats() const { return st; }
+
+  // {"seq":..,"sent":..,...}
+  void printStats(Print &out) const {
+    out.print(F("{\"seq\":")); out.print(seq);
+    out.print(F(",\"sent\":")); out.print(st.sent);
+    out.print(F(",\"retransmits\":")); out.print(st.retransmits);
+    out.print(F(",\"acked\":")); out.print(st.acked);
+    out.print(F(",\"unacked\":")); out.print(st.unacked);
+    out.print(F(",\"errors\":")); out.print(st.errors);
+    out.print(F(",\"awaitingAck\":")); out.print(ackActive ? F("true") : F("false"));
+    out.print('}');
+  }
+
+  void resetStats() { memset(&st, 0, sizeof(st)); }
+
+private:
+  bool sendPacket(uint16_t s, uint8_t flags, const String &body) {
+    uint8_t hdr[5] = { 'S', 'T', flags, (uint8_t)s, (uint8_t)(s >> 8) };
+    if (!udp.beginPacket(ip, port)) {
+      st.errors++;
+      return false;
+    }
+    udp.write(hdr, sizeof(hdr));
+    udp.write((const uint8_t *)body.c_str(), body.length());
+    if (udp.endPacket() != 1) {
+      st.errors++;
+      return false;
+    }
+    return true;
+  }
+
+  // Un envío fallido cuenta igual: lo cubre el reenvío
+  void transmit() {
+    sendPacket(ackSeq, UDP_FLAG_ACK, ackBody);
+    txCount++;
+    lastTxMs = millis();
+  }
+
+  void finishReliable(bool ok) {
+    HttpDoneFn done = ackDone;
+    ackActive = false;
+    ackFailed = !ok;
+    ackDone = nullptr;
+    if (ok) ackBody = String();   // fallido: se guarda para repetir el seq
+    if (done) done(ok);
+  }
+
+  EthernetUDP udp;
+  IPAddress ip;
+  uint16_t port;
+  uint16_t seq;
+
+  // Completado esperando ACK
+  bool ackActive;
+  bool ackFailed;          // el último agotó los envíos sin ACK
+  uint16_t ackSeq;
+  uint8_t txCount;
+  unsigned long lastTxMs;
+  HttpDoneFn ackDone;
+  String ackBody;
+
+  UdpStats st;
+};
+
+#endif